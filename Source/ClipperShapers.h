@@ -0,0 +1,351 @@
+/*
+ ==============================================================================
+
+ ClipperShapers.h
+ The two clipper curves and their antiderivative anti-aliased (ADAA) versions.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include "FastTanh.h"
+
+// Everything ADAA needs from tanh, got from one exp and one log1p per sample
+// logCosh is the 1st antiderivative of tanh, logCoshIntegral the 2nd (zero at u = 0)
+struct TanhTerms
+{
+    double tanh = 0.0;
+    double logCosh = 0.0;
+    double logCoshIntegral = 0.0;
+
+    template <bool withIntegral>
+    static TanhTerms evaluate (double u)
+    {
+        constexpr double ln2 = 0.69314718055994530942;
+        constexpr double piSquaredOver24 = 0.41123351671205660911;
+
+        // written in terms of e^-2|u| so nothing overflows for big inputs
+        const double a = std::abs (u);
+        const double e = std::exp (-2.0 * a);
+        const double l = std::log1p (e);
+
+        TanhTerms t;
+        t.tanh = std::copysign ((1.0 - e) / (1.0 + e), u);
+        t.logCosh = a + l - ln2;
+
+        if constexpr (withIntegral)
+        {
+            // integral of log(cosh) = u^2/2 - u ln2 + Li2(-e^-2u) / 2 + pi^2/24 for u >= 0 (odd in u)
+            // Landen's identity turns Li2(-e) into -B(l) - l^2/2 with l = ln(1 + e) <= ln2,
+            // where B is the Bernoulli series of the dilogarithm, which is tiny after 6 terms
+            const double l2 = l * l;
+            const double bernoulli = l * (1.0 + l * (-0.25 + l * (1.0 / 36.0 + l2 * (-1.0 / 3600.0
+                                         + l2 * (1.0 / 211680.0 + l2 * (-1.0 / 10886400.0 + l2 * (1.0 / 526901760.0)))))));
+            const double dilog = -bernoulli - 0.5 * l2;
+
+            t.logCoshIntegral = std::copysign (0.5 * a * a - a * ln2 + 0.5 * dilog + piSquaredOver24, u);
+        }
+
+        return t;
+    }
+};
+
+// One curve value plus its 1st and 2nd antiderivatives
+struct CurveTerms
+{
+    double f = 0.0;
+    double F1 = 0.0;
+    double F2 = 0.0;
+};
+
+// Stage 1: soft, pretty symmetric pre-shaping
+// vclip controls output amplitude, drive is amount of saturation basically
+struct SymmetricClipCurve
+{
+    static constexpr float vClip = 0.9f;
+    static constexpr float drive = 3.0f;
+
+    template <typename SampleType>
+    static SampleType process (SampleType x)
+    {
+        const SampleType y = SampleType (drive) * x / SampleType (vClip); // scale input by drive and ampltiude
+        return SampleType (vClip) * std::tanh (y);
+    }
+
+    // same curve over a whole block with the vectorised tanh
+    static void processBlock (float* data, int numSamples)
+    {
+        FastTanh::processAffine (data, numSamples, drive / vClip, 0.0f, vClip, 0.0f);
+    }
+
+    template <bool withSecond>
+    static CurveTerms evaluate (double x)
+    {
+        constexpr double v = vClip;
+        constexpr double k = (double) drive / (double) vClip;
+
+        const auto t = TanhTerms::evaluate<withSecond> (k * x);
+        return { v * t.tanh, v / k * t.logCosh, v / (k * k) * t.logCoshIntegral };
+    }
+};
+
+// Stage 2: add even harmonics for warmth
+// I realized that before I was only doing odd harmonics so I have to offset to also get some even ones
+struct OffsetClipCurve
+{
+    static constexpr float vClip = 0.8f;
+    static constexpr float drive = 5.0f;
+    static constexpr float offset = 0.25f; // controls asymmetry/offset
+
+    template <typename SampleType>
+    static SampleType process (SampleType x)
+    {
+        // subtract tanh(drive * offset) to center around 0 since tanh is odd
+        const SampleType yOffset = SampleType (drive) * (x + SampleType (offset));
+        const SampleType center = std::tanh (SampleType (drive) * SampleType (offset));
+
+        const SampleType shaped = std::tanh (yOffset) - center;
+
+        return SampleType (vClip) * shaped;
+    }
+
+    // same curve over a whole block with the vectorised tanh
+    static void processBlock (float* data, int numSamples)
+    {
+        const float center = std::tanh (drive * offset);
+        FastTanh::processAffine (data, numSamples, drive, drive * offset, vClip, -vClip * center);
+    }
+
+    template <bool withSecond>
+    static CurveTerms evaluate (double x)
+    {
+        constexpr double v = vClip;
+        constexpr double d = drive;
+        const double center = std::tanh ((double) drive * (double) offset);
+
+        const auto t = TanhTerms::evaluate<withSecond> (d * (x + (double) offset));
+        return { v * (t.tanh - center),
+                 v * (t.logCosh / d - center * x),
+                 v * (t.logCoshIntegral / (d * d) - 0.5 * center * x * x) };
+    }
+};
+
+// Antiderivative anti-aliasing for one of the curves above (Parker/Bilbao et al.)
+// 1st order = divided difference of F1, 2nd order = second divided difference of F2
+// The state is kept in double since F1/F2 get big for the hot input of clipper 1
+// and the differences would fall apart in float
+// Near equal samples use fallbacks built from values we already have, picked with
+// selects so the loop stays free of data dependent branches
+template <typename Curve>
+class AdaaShaper
+{
+    public:
+    enum class Order
+    {
+        first = 1,
+        second = 2
+    };
+
+    // 1st order delays by half a sample, 2nd order by one sample
+    static constexpr double getLatencyInSamples (Order order) { return order == Order::first ? 0.5 : 1.0; }
+
+    void reset()
+    {
+        const auto t = Curve::template evaluate<true> (0.0);
+
+        x1 = x2 = 0.0;
+        f1 = t.f;
+        F1_1 = F1_2 = t.F1;
+        F2_1 = t.F2;
+        D12 = t.F1;
+    }
+
+    template <typename SampleType>
+    void process (SampleType* data, int numSamples, Order order)
+    {
+        if (order == Order::first)
+            processFirstOrder (data, numSamples);
+        else
+            processSecondOrder (data, numSamples);
+    }
+
+    template <typename SampleType>
+    void processFirstOrder (SampleType* data, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double x0 = data[i];
+            const auto t = Curve::template evaluate<false> (x0);
+
+            const double d01 = x0 - x1;
+            const bool ill = std::abs (d01) < tolerance;
+
+            // (F1(x0) - F1(x1)) / (x0 - x1), which tends to f at the midpoint
+            const double adaa = (t.F1 - F1_1) / (ill ? 1.0 : d01);
+            const double midpoint = 0.5 * (t.f + f1);
+
+            data[i] = (SampleType) (ill ? midpoint : adaa);
+
+            x1 = x0;
+            f1 = t.f;
+            F1_1 = t.F1;
+        }
+    }
+
+    template <typename SampleType>
+    void processSecondOrder (SampleType* data, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double x0 = data[i];
+            const auto t = Curve::template evaluate<true> (x0);
+
+            // D(a, b) = (F2(a) - F2(b)) / (a - b), tends to F1 at the midpoint
+            const double d01 = x0 - x1;
+            const bool ill01 = std::abs (d01) < tolerance;
+            const double D01 = ill01 ? 0.5 * (t.F1 + F1_1) : (t.F2 - F2_1) / (ill01 ? 1.0 : d01);
+
+            // y = 2 (D(x0, x1) - D(x1, x2)) / (x0 - x2)
+            const double d02 = x0 - x2;
+            const bool ill02 = std::abs (d02) < tolerance;
+            const double main = 2.0 * (D01 - D12) / (ill02 ? 1.0 : d02);
+
+            // x0 ~ x2: the limit is 2 / delta * (F1(xb) - D(xb, x1)) with xb the mean of x0 and x2
+            const double delta = 0.5 * d02 + (x2 - x1);
+            const bool illDelta = std::abs (delta) < tolerance;
+            const double folded = 2.0 * (0.5 * (t.F1 + F1_2) - 0.5 * (D01 + D12)) / (illDelta ? 1.0 : delta);
+
+            // and if all three are about the same it's just the curve at the middle sample
+            const double fallback = illDelta ? f1 : folded;
+
+            data[i] = (SampleType) (ill02 ? fallback : main);
+
+            x2 = x1;
+            x1 = x0;
+            f1 = t.f;
+            F1_2 = F1_1;
+            F1_1 = t.F1;
+            F2_1 = t.F2;
+            D12 = D01;
+        }
+    }
+
+    private:
+    static constexpr double tolerance = 1.0e-5;
+
+    double x1 = 0.0, x2 = 0.0;   // previous inputs
+    double f1 = 0.0;             // f(x1)
+    double F1_1 = 0.0, F1_2 = 0.0; // F1(x1), F1(x2)
+    double F2_1 = 0.0;           // F2(x1)
+    double D12 = 0.0;            // D(x1, x2) from the last sample
+};
+
+// How a ShaperStage evaluates its curve
+enum class ShaperMode
+{
+    fast = 0,        // vectorised fast tanh over the block
+    adaaFirstOrder,
+    adaaSecondOrder,
+    exact            // std::tanh per sample, the original curves
+};
+
+// One clipper stage for the ProcessorChain, with the curve baked in as a type
+// so there's no function pointer per sample like juce::dsp::WaveShaper has
+// Curve supplies process() (exact, scalar), processBlock() (vectorised) and evaluate<>() (for ADAA)
+// Holds ADAA history, so use one stage per mono chain
+// The fast tanh is float only, in double the fast mode is the exact curve (that path is there for precision anyway)
+template <typename Curve, typename SampleType = float>
+class ShaperStage
+{
+    public:
+    using Mode = ShaperMode;
+
+    template <typename ProcessSpec>
+    void prepare (const ProcessSpec&) noexcept
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        adaa.reset();
+    }
+
+    void setMode (Mode newMode) noexcept
+    {
+        if (newMode == mode)
+            return;
+
+        mode = newMode;
+        adaa.reset(); // fresh history so the divided differences don't see stale samples
+    }
+
+    Mode getMode() const noexcept { return mode; }
+
+    double getLatencyInSamples() const noexcept
+    {
+        if (mode == Mode::adaaFirstOrder)
+            return AdaaShaper<Curve>::getLatencyInSamples (AdaaShaper<Curve>::Order::first);
+
+        if (mode == Mode::adaaSecondOrder)
+            return AdaaShaper<Curve>::getLatencyInSamples (AdaaShaper<Curve>::Order::second);
+
+        return 0.0;
+    }
+
+    template <typename ProcessContext>
+    void process (const ProcessContext& context) noexcept
+    {
+        auto&& inputBlock = context.getInputBlock();
+        auto&& outputBlock = context.getOutputBlock();
+        const int numSamples = (int) outputBlock.getNumSamples();
+
+        for (size_t channel = 0; channel < outputBlock.getNumChannels(); ++channel)
+        {
+            const SampleType* input = inputBlock.getChannelPointer (channel);
+            SampleType* output = outputBlock.getChannelPointer (channel);
+
+            if (input != output)
+                std::copy (input, input + numSamples, output);
+
+            if (! context.isBypassed)
+                processSamples (output, numSamples);
+        }
+    }
+
+    // in place over raw samples, the mode switch is once per block, not per sample
+    void processSamples (SampleType* data, int numSamples) noexcept
+    {
+        switch (mode)
+        {
+            case Mode::fast:
+                if constexpr (std::is_same_v<SampleType, float>)
+                {
+                    Curve::processBlock (data, numSamples);
+                    break;
+                }
+                [[fallthrough]];
+
+            case Mode::exact:
+                for (int i = 0; i < numSamples; ++i)
+                    data[i] = Curve::process (data[i]);
+                break;
+
+            case Mode::adaaFirstOrder:
+                adaa.processFirstOrder (data, numSamples);
+                break;
+
+            case Mode::adaaSecondOrder:
+                adaa.processSecondOrder (data, numSamples);
+                break;
+        }
+    }
+
+    private:
+    Mode mode = Mode::fast;
+    AdaaShaper<Curve> adaa;
+};
@@ -0,0 +1,96 @@
+/*
+ ==============================================================================
+
+ CompositeClipTable.h
+ Clipper 1 -> Clipper 2 baked into one interpolated lookup table.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include "ClipperShapers.h"
+#include "DspKernels.h"
+
+// Both clippers are memoryless and run back to back, so together they are just one fixed curve
+// Outside +-inputLimit both tanh stages are flat to float precision, so the input gets clamped
+// Table is built once in double and shared by every instance (it never changes, not even with sample rate)
+class CompositeClipTable
+{
+    public:
+    static constexpr float inputLimit = 4.0f;
+    static constexpr int numSegments = 16384; // 64 kB, linear interpolation error stays under 5e-6 (-106 dB)
+
+    CompositeClipTable()
+    {
+        table.resize ((size_t) numSegments + 2);
+
+        for (int i = 0; i <= numSegments; ++i)
+        {
+            const double x = -inputLimit + (double) i / (double) scale;
+            const double y1 = SymmetricClipCurve::evaluate<false> (x).f;
+            table[(size_t) i] = (float) OffsetClipCurve::evaluate<false> (y1).f;
+        }
+
+        // guard point so the clamped top edge can still read i + 1
+        table[(size_t) numSegments + 1] = table[(size_t) numSegments];
+    }
+
+    // Every caller gets the same table, the first one to ask builds it (do this off the audio thread)
+    static std::shared_ptr<const CompositeClipTable> getShared()
+    {
+        static std::mutex mutex;
+        static std::weak_ptr<const CompositeClipTable> cached;
+
+        const std::lock_guard<std::mutex> lock (mutex);
+        auto shared = cached.lock();
+
+        if (shared == nullptr)
+        {
+            shared = std::make_shared<const CompositeClipTable>();
+            cached = shared;
+        }
+
+        return shared;
+    }
+
+    template <typename SampleType>
+    SampleType process (SampleType x) const
+    {
+        const SampleType limit = inputLimit;
+        const SampleType position = (std::clamp (x, -limit, limit) + limit) * SampleType (scale);
+        const int index = std::min ((int) position, numSegments - 1);
+        const SampleType frac = position - (SampleType) index;
+
+        const SampleType a = table[(size_t) index];
+        const SampleType b = table[(size_t) index + 1];
+        return a + frac * (b - a);
+    }
+
+    // replaces the two tanh evaluations per sample with one read + lerp
+    // (float gets the SIMD version from DspKernels, gathers where the CPU has them)
+    template <typename SampleType>
+    void processBlock (SampleType* data, int numSamples) const
+    {
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            DspKernels::get().tableLookup (data, numSamples, table.data(), numSegments, inputLimit, scale);
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = process (data[i]);
+        }
+    }
+
+    private:
+    static constexpr float scale = (float) numSegments / (2.0f * inputLimit);
+
+    std::vector<float> table;
+};
@@ -0,0 +1,232 @@
+/*
+ ==============================================================================
+
+ DspKernels.cpp
+ CPU detection and the choice of kernels.
+
+ ==============================================================================
+ */
+
+#include "DspKernels.h"
+
+#include <atomic>
+#include <initializer_list>
+#include <cstdlib>
+#include <cstring>
+
+#if FUZZCOLA_KERNELS_X86
+ #if defined (_MSC_VER)
+  #include <intrin.h>
+ #else
+  #include <cpuid.h>
+ #endif
+#endif
+
+namespace
+{
+   #if FUZZCOLA_KERNELS_X86
+    struct CpuId
+    {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    };
+
+    CpuId cpuid (unsigned int leaf, unsigned int subleaf)
+    {
+        CpuId r;
+
+       #if defined (_MSC_VER)
+        int regs[4] = {};
+        __cpuidex (regs, (int) leaf, (int) subleaf);
+        r.eax = (unsigned int) regs[0];
+        r.ebx = (unsigned int) regs[1];
+        r.ecx = (unsigned int) regs[2];
+        r.edx = (unsigned int) regs[3];
+       #else
+        __cpuid_count (leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+       #endif
+
+        return r;
+    }
+
+    // which register sets the OS saves on a context switch (XCR0)
+    unsigned long long enabledRegisterState()
+    {
+       #if defined (_MSC_VER)
+        return _xgetbv (0);
+       #else
+        unsigned int lo = 0, hi = 0;
+        __asm__ volatile ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+        return ((unsigned long long) hi << 32) | lo;
+       #endif
+    }
+
+    // The CPU having the instructions isn't enough for AVX, the OS has to be saving the wider
+    // registers too, or the first context switch corrupts them
+    struct X86Features
+    {
+        bool sse2 = false, avx2 = false, avx512 = false;
+
+        X86Features()
+        {
+            const unsigned int maxLeaf = cpuid (0, 0).eax;
+            const CpuId leaf1 = cpuid (1, 0);
+
+            sse2 = (leaf1.edx & (1u << 26)) != 0;
+
+            const bool osSavesAvx = (leaf1.ecx & (1u << 27)) != 0                     // OSXSAVE
+                                 && (enabledRegisterState() & 0x6) == 0x6;            // XMM + YMM
+            const bool avx = (leaf1.ecx & (1u << 28)) != 0;
+            const bool fma = (leaf1.ecx & (1u << 12)) != 0;
+
+            if (maxLeaf < 7 || ! osSavesAvx || ! avx)
+                return;
+
+            const CpuId leaf7 = cpuid (7, 0);
+            avx2 = fma && (leaf7.ebx & (1u << 5)) != 0;
+
+            const bool osSavesAvx512 = (enabledRegisterState() & 0xe6) == 0xe6;        // + opmask, ZMM
+            avx512 = avx2 && osSavesAvx512 && (leaf7.ebx & (1u << 16)) != 0;         // AVX-512F
+        }
+    };
+
+    const X86Features& getX86Features()
+    {
+        static const X86Features features;
+        return features;
+    }
+   #endif
+
+    const DspKernels::Table* getVariant (DspKernels::Isa isa) noexcept
+    {
+        using DspKernels::Isa;
+
+        switch (isa)
+        {
+            case Isa::generic: return DspKernels::Variants::generic();
+            case Isa::sse2:    return DspKernels::Variants::sse2();
+            case Isa::avx2:    return DspKernels::Variants::avx2();
+            case Isa::avx512:  return DspKernels::Variants::avx512();
+            case Isa::neon:    return DspKernels::Variants::neon();
+        }
+
+        return DspKernels::Variants::generic();
+    }
+
+    // FUZZCOLA_KERNELS from the environment, if it names something this machine can run
+    bool getIsaFromEnvironment (DspKernels::Isa& isa)
+    {
+        const char* requested = std::getenv ("FUZZCOLA_KERNELS");
+
+        if (requested == nullptr)
+            return false;
+
+        for (const auto candidate : { DspKernels::Isa::generic, DspKernels::Isa::sse2, DspKernels::Isa::avx2,
+                                      DspKernels::Isa::avx512, DspKernels::Isa::neon })
+        {
+            if (std::strcmp (requested, DspKernels::getIsaName (candidate)) == 0 && DspKernels::isSupported (candidate))
+            {
+                isa = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    struct Selection
+    {
+        DspKernels::Isa isa = DspKernels::Isa::generic;
+        const DspKernels::Table* table = nullptr;
+
+        Selection()
+        {
+            if (! getIsaFromEnvironment (isa))
+                isa = DspKernels::getBestSupportedIsa();
+
+            table = getVariant (isa);
+        }
+    };
+
+    // picked once, the first time anything asks
+    const Selection& getSelection()
+    {
+        static const Selection selection;
+        return selection;
+    }
+
+    std::atomic<int> forcedIsa { -1 };
+}
+
+const DspKernels::Table& DspKernels::get() noexcept
+{
+    const int forced = forcedIsa.load (std::memory_order_acquire);
+
+    if (forced >= 0)
+        return *getVariant ((Isa) forced);
+
+    return *getSelection().table;
+}
+
+DspKernels::Isa DspKernels::getActiveIsa() noexcept
+{
+    const int forced = forcedIsa.load (std::memory_order_acquire);
+    return forced >= 0 ? (Isa) forced : getSelection().isa;
+}
+
+DspKernels::Isa DspKernels::getBestSupportedIsa() noexcept
+{
+    for (const auto isa : { Isa::avx512, Isa::avx2, Isa::neon, Isa::sse2 })
+        if (isSupported (isa))
+            return isa;
+
+    return Isa::generic;
+}
+
+bool DspKernels::isSupported (Isa isa) noexcept
+{
+    if (getVariant (isa) == nullptr)
+        return false;
+
+   #if FUZZCOLA_KERNELS_X86
+    const auto& features = getX86Features();
+
+    switch (isa)
+    {
+        case Isa::sse2:   return features.sse2;
+        case Isa::avx2:   return features.avx2;
+        case Isa::avx512: return features.avx512;
+        default:          break;
+    }
+   #endif
+
+    // generic always runs, and NEON is only in the build on arm64, where it's always there
+    return true;
+}
+
+const char* DspKernels::getIsaName (Isa isa) noexcept
+{
+    switch (isa)
+    {
+        case Isa::generic: return "generic";
+        case Isa::sse2:    return "sse2";
+        case Isa::avx2:    return "avx2";
+        case Isa::avx512:  return "avx512";
+        case Isa::neon:    return "neon";
+    }
+
+    return "generic";
+}
+
+bool DspKernels::forceIsa (Isa isa) noexcept
+{
+    if (! isSupported (isa))
+        return false;
+
+    forcedIsa.store ((int) isa, std::memory_order_release);
+    return true;
+}
+
+void DspKernels::clearForcedIsa() noexcept
+{
+    forcedIsa.store (-1, std::memory_order_release);
+}
@@ -0,0 +1,123 @@
+/*
+ ==============================================================================
+
+ DspKernels.h
+ The hot inner loops, built for several instruction sets and picked at load time.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <type_traits>
+
+#if defined (__x86_64__) || defined (__i386__) || defined (_M_X64) || defined (_M_IX86)
+ #define FUZZCOLA_KERNELS_X86 1
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #define FUZZCOLA_KERNELS_NEON 1
+#endif
+
+// The plugin itself is built for the baseline of its architecture (SSE2 / plain ARMv8), so anything
+// wider has to be chosen at runtime. Every kernel lives in one translation unit per instruction set
+// (DspKernelsSse2.cpp, DspKernelsAvx2.cpp, ...), each compiled for its own target through a pragma,
+// and the best one the CPU can run gets picked the first time get() is called (the FuzzColaEngine
+// constructor does that, so it's done before any audio). Float only, the double engine is there
+// for precision and keeps its own loops.
+//
+// FUZZCOLA_KERNELS=generic|sse2|avx2|avx512|neon in the environment, or forceIsa(), overrides the
+// choice for testing (anything the CPU can't run is refused rather than crashing)
+namespace DspKernels
+{
+    enum class Isa
+    {
+        generic = 0,   // plain C++, whatever the compiler makes of it
+        sse2,
+        avx2,          // with FMA
+        avx512,        // AVX-512F
+        neon
+    };
+
+    // Block state-space filter matrices (see BlockStateSpace), all row major as they're stored there
+    struct StateSpaceMatrices
+    {
+        int order = 0;
+        int blockSize = 0;
+        const float* freeResponse = nullptr;      // [order][blockSize]
+        const float* forcedResponse = nullptr;    // [blockSize][blockSize]
+        const float* stateTransition = nullptr;   // [order][order]
+        const float* stateInput = nullptr;        // [blockSize][order]
+    };
+
+    static constexpr int maxStateSpaceOrder = 8;
+    static constexpr int maxStateSpaceBlockSize = 64;
+
+    struct Table
+    {
+        // shapers: data = outGain * fastTanh (inGain * data + inBias) + outBias
+        void (*tanhAffine) (float* data, int numSamples, float inGain, float inBias, float outGain, float outBias);
+
+        // composite clipper table: clamp to +-inputLimit, scale into the table, linear interpolation
+        void (*tableLookup) (float* data, int numSamples, const float* table, int numSegments, float inputLimit, float scale);
+
+        // filters: numBlocks whole blocks of a block state-space system, in place, output scaled by gain
+        void (*stateSpaceBlocks) (float* data, int numBlocks, float* state, const StateSpaceMatrices& matrices, float gain);
+
+        // gain ramps: data[i] *= gains[i]
+        void (*applyGains) (float* data, const float* gains, int numSamples);
+
+        // crossfades: data[i] = from[i] + ramp[i] * (data[i] - from[i])
+        void (*crossfade) (float* data, const float* from, const float* ramp, int numSamples);
+    };
+
+    // the kernels for the chosen instruction set, safe to call from any thread
+    const Table& get() noexcept;
+
+    Isa getActiveIsa() noexcept;
+    Isa getBestSupportedIsa() noexcept;
+    bool isSupported (Isa isa) noexcept;
+    const char* getIsaName (Isa isa) noexcept;
+
+    // testing: runs everything on isa from now on (false, and no change, if this CPU or build can't)
+    bool forceIsa (Isa isa) noexcept;
+    void clearForcedIsa() noexcept;
+
+    // One per translation unit, nullptr when that instruction set isn't part of this build
+    // (AVX on an ARM build and so on). Only call the ones isSupported() says the CPU can run
+    namespace Variants
+    {
+        const Table* generic() noexcept;
+        const Table* sse2() noexcept;
+        const Table* avx2() noexcept;
+        const Table* avx512() noexcept;
+        const Table* neon() noexcept;
+    }
+
+    // float goes through the dispatched kernels, double keeps plain loops
+    template <typename SampleType>
+    inline void applyGains (SampleType* data, const SampleType* gains, int numSamples) noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            get().applyGains (data, gains, numSamples);
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+                data[i] *= gains[i];
+        }
+    }
+
+    template <typename SampleType>
+    inline void crossfade (SampleType* data, const SampleType* from, const SampleType* ramp, int numSamples) noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            get().crossfade (data, from, ramp, numSamples);
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = from[i] + ramp[i] * (data[i] - from[i]);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ ==============================================================================
+
+ DspKernelsAvx2.cpp
+ The kernels on 8 floats at a time with AVX2 and FMA.
+
+ ==============================================================================
+ */
+
+#include "DspKernels.h"
+
+#if FUZZCOLA_KERNELS_X86
+
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+// everything from here to the pop is compiled for AVX2 + FMA (see DspKernelsImpl.h for why it's kept in here)
+#if defined (__clang__)
+ #pragma clang attribute push (__attribute__ ((target ("avx2,fma"))), apply_to = function)
+#elif defined (__GNUC__)
+ #pragma GCC push_options
+ #pragma GCC target ("avx2,fma")
+#endif
+
+namespace
+{
+    struct Vec
+    {
+        static constexpr int size = 8;
+        __m256 v;
+
+        Vec (__m256 x) : v (x) {}
+        Vec (float x) : v (_mm256_set1_ps (x)) {}
+        static Vec load (const float* p) { return _mm256_loadu_ps (p); }
+        void store (float* p) const { _mm256_storeu_ps (p, v); }
+
+        static Vec min (Vec a, Vec b) { return _mm256_min_ps (a.v, b.v); }
+        static Vec max (Vec a, Vec b) { return _mm256_max_ps (a.v, b.v); }
+        static Vec clamp (Vec x, Vec lo, Vec hi) { return _mm256_min_ps (_mm256_max_ps (x.v, lo.v), hi.v); }
+        static Vec multiplyAdd (Vec a, Vec b, Vec c) { return _mm256_fmadd_ps (a.v, b.v, c.v); }
+        static Vec truncate (Vec x) { return _mm256_round_ps (x.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+
+        static Vec gather (const float* table, Vec index)
+        {
+            return _mm256_i32gather_ps (table, _mm256_cvttps_epi32 (index.v), 4);
+        }
+    };
+
+    // out here rather than as friends, GCC doesn't apply the target pragma to friends defined in a class
+    inline Vec operator+ (Vec a, Vec b) { return _mm256_add_ps (a.v, b.v); }
+    inline Vec operator- (Vec a, Vec b) { return _mm256_sub_ps (a.v, b.v); }
+    inline Vec operator* (Vec a, Vec b) { return _mm256_mul_ps (a.v, b.v); }
+    inline Vec operator/ (Vec a, Vec b) { return _mm256_div_ps (a.v, b.v); }
+}
+
+#include "DspKernelsImpl.h"
+
+namespace
+{
+    template struct Kernels<Vec>;
+}
+
+#if defined (__clang__)
+ #pragma clang attribute pop
+#elif defined (__GNUC__)
+ #pragma GCC pop_options
+#endif
+
+const DspKernels::Table* DspKernels::Variants::avx2() noexcept
+{
+    return &Kernels<Vec>::table;
+}
+
+#else
+
+const DspKernels::Table* DspKernels::Variants::avx2() noexcept
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ ==============================================================================
+
+ DspKernelsAvx512.cpp
+ The kernels on 16 floats at a time with AVX-512.
+
+ ==============================================================================
+ */
+
+#include "DspKernels.h"
+
+#if FUZZCOLA_KERNELS_X86
+
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+// everything from here to the pop is compiled for AVX-512F (see DspKernelsImpl.h for why it's kept in here)
+#if defined (__clang__)
+ #pragma clang attribute push (__attribute__ ((target ("avx512f,avx2,fma"))), apply_to = function)
+#elif defined (__GNUC__)
+ #pragma GCC push_options
+ #pragma GCC target ("avx512f,avx2,fma")
+#endif
+
+namespace
+{
+    struct Vec
+    {
+        static constexpr int size = 16;
+        __m512 v;
+
+        Vec (__m512 x) : v (x) {}
+        Vec (float x) : v (_mm512_set1_ps (x)) {}
+        static Vec load (const float* p) { return _mm512_loadu_ps (p); }
+        void store (float* p) const { _mm512_storeu_ps (p, v); }
+
+        static Vec min (Vec a, Vec b) { return _mm512_min_ps (a.v, b.v); }
+        static Vec max (Vec a, Vec b) { return _mm512_max_ps (a.v, b.v); }
+        static Vec clamp (Vec x, Vec lo, Vec hi) { return _mm512_min_ps (_mm512_max_ps (x.v, lo.v), hi.v); }
+        static Vec multiplyAdd (Vec a, Vec b, Vec c) { return _mm512_fmadd_ps (a.v, b.v, c.v); }
+        static Vec truncate (Vec x) { return _mm512_roundscale_ps (x.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+
+        static Vec gather (const float* table, Vec index)
+        {
+            return _mm512_i32gather_ps (_mm512_cvttps_epi32 (index.v), table, 4);
+        }
+    };
+
+    // out here rather than as friends, GCC doesn't apply the target pragma to friends defined in a class
+    inline Vec operator+ (Vec a, Vec b) { return _mm512_add_ps (a.v, b.v); }
+    inline Vec operator- (Vec a, Vec b) { return _mm512_sub_ps (a.v, b.v); }
+    inline Vec operator* (Vec a, Vec b) { return _mm512_mul_ps (a.v, b.v); }
+    inline Vec operator/ (Vec a, Vec b) { return _mm512_div_ps (a.v, b.v); }
+}
+
+#include "DspKernelsImpl.h"
+
+namespace
+{
+    template struct Kernels<Vec>;
+}
+
+#if defined (__clang__)
+ #pragma clang attribute pop
+#elif defined (__GNUC__)
+ #pragma GCC pop_options
+#endif
+
+const DspKernels::Table* DspKernels::Variants::avx512() noexcept
+{
+    return &Kernels<Vec>::table;
+}
+
+#else
+
+const DspKernels::Table* DspKernels::Variants::avx512() noexcept
+{
+    return nullptr;
+}
+
+#endif
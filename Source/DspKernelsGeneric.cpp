@@ -0,0 +1,22 @@
+/*
+ ==============================================================================
+
+ DspKernelsGeneric.cpp
+ The kernels as plain C++, the fallback every build has.
+
+ ==============================================================================
+ */
+
+#include "DspKernels.h"
+#include "DspKernelsImpl.h"
+
+// built with the plugin's own flags, so this is whatever the baseline gives (SSE2 on x64, NEON on arm64)
+namespace
+{
+    template struct Kernels<Scalar>;
+}
+
+const DspKernels::Table* DspKernels::Variants::generic() noexcept
+{
+    return &Kernels<Scalar>::table;
+}
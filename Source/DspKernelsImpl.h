@@ -0,0 +1,206 @@
+/*
+ ==============================================================================
+
+ DspKernelsImpl.h
+ The kernel bodies, written once over a SIMD wrapper, compiled once per instruction set.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "DspKernels.h"
+#include "FastTanhApproximation.h"
+
+// Only for the DspKernels*.cpp files. Each of them defines a Vec (the widest register it has) in an
+// anonymous namespace and includes this inside its target pragma, so everything here, Scalar
+// included, is compiled for that target and stays private to that translation unit.
+// Nothing in here may call a shared inline function (that's why there's no std::min and friends):
+// the linker keeps one copy of those for the whole plugin, and if it kept the AVX one the
+// generic build would crash on the CPUs it's there for. The same goes for what it includes,
+// hence FastTanhApproximation.h (constants and a template) rather than FastTanh.h.
+//
+// Vec needs: size, Vec (float), load, store, + - * /, min, max, clamp, multiplyAdd (a * b + c),
+// truncate (towards zero, as float) and gather (table[index] per lane, index as float)
+namespace
+{
+    // one sample at a time, the tail of every loop (and the whole of the generic build)
+    struct Scalar
+    {
+        static constexpr int size = 1;
+        float v;
+
+        Scalar (float x) : v (x) {}
+        static Scalar load (const float* p) { return *p; }
+        void store (float* p) const { *p = v; }
+
+        friend Scalar operator+ (Scalar a, Scalar b) { return a.v + b.v; }
+        friend Scalar operator- (Scalar a, Scalar b) { return a.v - b.v; }
+        friend Scalar operator* (Scalar a, Scalar b) { return a.v * b.v; }
+        friend Scalar operator/ (Scalar a, Scalar b) { return a.v / b.v; }
+
+        static Scalar min (Scalar a, Scalar b) { return b.v < a.v ? b : a; }
+        static Scalar max (Scalar a, Scalar b) { return a.v < b.v ? b : a; }
+        static Scalar clamp (Scalar x, Scalar lo, Scalar hi) { return min (max (x, lo), hi); }
+        static Scalar multiplyAdd (Scalar a, Scalar b, Scalar c) { return a.v * b.v + c.v; }
+        static Scalar truncate (Scalar x) { return (float) (int) x.v; }
+        static Scalar gather (const float* table, Scalar index) { return table[(int) index.v]; }
+    };
+
+    template <typename V>
+    inline void tanhAffineLoop (float* data, int& i, int numSamples, float inGain, float inBias, float outGain, float outBias)
+    {
+        const V ig (inGain), ib (inBias), og (outGain), ob (outBias);
+
+        for (; i + V::size <= numSamples; i += V::size)
+        {
+            const V x = V::multiplyAdd (V::load (data + i), ig, ib);
+            V::multiplyAdd (og, FastTanh::approximate (x), ob).store (data + i);
+        }
+    }
+
+    template <typename V>
+    inline void tableLookupLoop (float* data, int& i, int numSamples, const float* table, int numSegments,
+                                 float inputLimit, float scale)
+    {
+        const V limit (inputLimit), negativeLimit (-inputLimit), tableScale (scale), lastIndex ((float) (numSegments - 1));
+
+        for (; i + V::size <= numSamples; i += V::size)
+        {
+            // same steps as CompositeClipTable::process
+            const V position = (V::clamp (V::load (data + i), negativeLimit, limit) + limit) * tableScale;
+            const V index = V::truncate (V::min (position, lastIndex));
+            const V frac = position - index;
+
+            const V a = V::gather (table, index);
+            const V b = V::gather (table + 1, index);
+            V::multiplyAdd (frac, b - a, a).store (data + i);
+        }
+    }
+
+    template <typename V>
+    inline void applyGainsLoop (float* data, const float* gains, int& i, int numSamples)
+    {
+        for (; i + V::size <= numSamples; i += V::size)
+            (V::load (data + i) * V::load (gains + i)).store (data + i);
+    }
+
+    template <typename V>
+    inline void crossfadeLoop (float* data, const float* from, const float* ramp, int& i, int numSamples)
+    {
+        for (; i + V::size <= numSamples; i += V::size)
+        {
+            const V f = V::load (from + i);
+            V::multiplyAdd (V::load (ramp + i), V::load (data + i) - f, f).store (data + i);
+        }
+    }
+
+    // The block state-space loop (see BlockStateSpace::process) with every block's outputs
+    // vectorised. forcedResponse is zero below its diagonal, so inputs after the last output of a
+    // vector don't get multiplied in at all
+    template <typename V>
+    void stateSpaceBlocksLoop (float* data, int numBlocks, float* state, const DspKernels::StateSpaceMatrices& m, float gain)
+    {
+        const int order = m.order;
+        const int blockSize = m.blockSize;
+        const int width = blockSize % V::size == 0 ? V::size : 1;
+
+        float x[DspKernels::maxStateSpaceOrder];
+        float y[DspKernels::maxStateSpaceBlockSize];
+
+        for (int s = 0; s < order; ++s)
+            x[s] = state[s];
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            float* u = data + b * blockSize;
+
+            for (int k = 0; k < blockSize; k += width)
+            {
+                if (width == V::size)
+                {
+                    V sum (0.0f);
+
+                    for (int s = 0; s < order; ++s)
+                        sum = V::multiplyAdd (V::load (m.freeResponse + s * blockSize + k), V (x[s]), sum);
+
+                    for (int j = 0; j < k + width; ++j)
+                        sum = V::multiplyAdd (V::load (m.forcedResponse + j * blockSize + k), V (u[j]), sum);
+
+                    (sum * V (gain)).store (y + k);
+                }
+                else
+                {
+                    float sum = 0.0f;
+
+                    for (int s = 0; s < order; ++s)
+                        sum += m.freeResponse[s * blockSize + k] * x[s];
+
+                    for (int j = 0; j <= k; ++j)
+                        sum += m.forcedResponse[j * blockSize + k] * u[j];
+
+                    y[k] = gain * sum;
+                }
+            }
+
+            float next[DspKernels::maxStateSpaceOrder] = {};
+
+            for (int s = 0; s < order; ++s)
+                for (int r = 0; r < order; ++r)
+                    next[r] += m.stateTransition[s * order + r] * x[s];
+
+            for (int j = 0; j < blockSize; ++j)
+                for (int r = 0; r < order; ++r)
+                    next[r] += m.stateInput[j * order + r] * u[j];
+
+            for (int k = 0; k < blockSize; ++k)
+                u[k] = y[k];
+
+            for (int s = 0; s < order; ++s)
+                x[s] = next[s];
+        }
+
+        for (int s = 0; s < order; ++s)
+            state[s] = x[s];
+    }
+
+    // Whole kernels: the widest loop first, Scalar for what's left
+    template <typename V>
+    struct Kernels
+    {
+        static void tanhAffine (float* data, int numSamples, float inGain, float inBias, float outGain, float outBias)
+        {
+            int i = 0;
+            tanhAffineLoop<V> (data, i, numSamples, inGain, inBias, outGain, outBias);
+            tanhAffineLoop<Scalar> (data, i, numSamples, inGain, inBias, outGain, outBias);
+        }
+
+        static void tableLookup (float* data, int numSamples, const float* table, int numSegments, float inputLimit, float scale)
+        {
+            int i = 0;
+            tableLookupLoop<V> (data, i, numSamples, table, numSegments, inputLimit, scale);
+            tableLookupLoop<Scalar> (data, i, numSamples, table, numSegments, inputLimit, scale);
+        }
+
+        static void stateSpaceBlocks (float* data, int numBlocks, float* state, const DspKernels::StateSpaceMatrices& matrices, float gain)
+        {
+            stateSpaceBlocksLoop<V> (data, numBlocks, state, matrices, gain);
+        }
+
+        static void applyGains (float* data, const float* gains, int numSamples)
+        {
+            int i = 0;
+            applyGainsLoop<V> (data, gains, i, numSamples);
+            applyGainsLoop<Scalar> (data, gains, i, numSamples);
+        }
+
+        static void crossfade (float* data, const float* from, const float* ramp, int numSamples)
+        {
+            int i = 0;
+            crossfadeLoop<V> (data, from, ramp, i, numSamples);
+            crossfadeLoop<Scalar> (data, from, ramp, i, numSamples);
+        }
+
+        static constexpr DspKernels::Table table { tanhAffine, tableLookup, stateSpaceBlocks, applyGains, crossfade };
+    };
+}
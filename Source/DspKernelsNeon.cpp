@@ -0,0 +1,73 @@
+/*
+ ==============================================================================
+
+ DspKernelsNeon.cpp
+ The kernels on 4 floats at a time with NEON.
+
+ ==============================================================================
+ */
+
+#include "DspKernels.h"
+
+#if FUZZCOLA_KERNELS_NEON
+
+#include <algorithm>
+#include <cmath>
+#include <arm_neon.h>
+
+// NEON is part of every arm64 target, so unlike the x86 ones this needs no target pragma
+namespace
+{
+    struct Vec
+    {
+        static constexpr int size = 4;
+        float32x4_t v;
+
+        Vec (float32x4_t x) : v (x) {}
+        Vec (float x) : v (vdupq_n_f32 (x)) {}
+        static Vec load (const float* p) { return vld1q_f32 (p); }
+        void store (float* p) const { vst1q_f32 (p, v); }
+
+        static Vec min (Vec a, Vec b) { return vminq_f32 (a.v, b.v); }
+        static Vec max (Vec a, Vec b) { return vmaxq_f32 (a.v, b.v); }
+        static Vec clamp (Vec x, Vec lo, Vec hi) { return vminq_f32 (vmaxq_f32 (x.v, lo.v), hi.v); }
+        static Vec multiplyAdd (Vec a, Vec b, Vec c) { return vfmaq_f32 (c.v, a.v, b.v); }
+        static Vec truncate (Vec x) { return vcvtq_f32_s32 (vcvtq_s32_f32 (x.v)); }
+
+        // no gather on NEON, the lanes get read one by one
+        static Vec gather (const float* table, Vec index)
+        {
+            const int32x4_t lanes = vcvtq_s32_f32 (index.v);
+            float values[size] = { table[vgetq_lane_s32 (lanes, 0)], table[vgetq_lane_s32 (lanes, 1)],
+                                   table[vgetq_lane_s32 (lanes, 2)], table[vgetq_lane_s32 (lanes, 3)] };
+            return vld1q_f32 (values);
+        }
+    };
+
+    // out here rather than as friends, GCC doesn't apply the target pragma to friends defined in a class
+    inline Vec operator+ (Vec a, Vec b) { return vaddq_f32 (a.v, b.v); }
+    inline Vec operator- (Vec a, Vec b) { return vsubq_f32 (a.v, b.v); }
+    inline Vec operator* (Vec a, Vec b) { return vmulq_f32 (a.v, b.v); }
+    inline Vec operator/ (Vec a, Vec b) { return vdivq_f32 (a.v, b.v); }
+}
+
+#include "DspKernelsImpl.h"
+
+namespace
+{
+    template struct Kernels<Vec>;
+}
+
+const DspKernels::Table* DspKernels::Variants::neon() noexcept
+{
+    return &Kernels<Vec>::table;
+}
+
+#else
+
+const DspKernels::Table* DspKernels::Variants::neon() noexcept
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ ==============================================================================
+
+ DspKernelsSse2.cpp
+ The kernels on 4 floats at a time with SSE2.
+
+ ==============================================================================
+ */
+
+#include "DspKernels.h"
+
+#if FUZZCOLA_KERNELS_X86
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+// everything from here to the pop is compiled for SSE2 (see DspKernelsImpl.h for why it's kept in here)
+#if defined (__clang__)
+ #pragma clang attribute push (__attribute__ ((target ("sse2"))), apply_to = function)
+#elif defined (__GNUC__)
+ #pragma GCC push_options
+ #pragma GCC target ("sse2")
+#endif
+
+namespace
+{
+    struct Vec
+    {
+        static constexpr int size = 4;
+        __m128 v;
+
+        Vec (__m128 x) : v (x) {}
+        Vec (float x) : v (_mm_set1_ps (x)) {}
+        static Vec load (const float* p) { return _mm_loadu_ps (p); }
+        void store (float* p) const { _mm_storeu_ps (p, v); }
+
+        static Vec min (Vec a, Vec b) { return _mm_min_ps (a.v, b.v); }
+        static Vec max (Vec a, Vec b) { return _mm_max_ps (a.v, b.v); }
+        static Vec clamp (Vec x, Vec lo, Vec hi) { return _mm_min_ps (_mm_max_ps (x.v, lo.v), hi.v); }
+        static Vec multiplyAdd (Vec a, Vec b, Vec c) { return _mm_add_ps (_mm_mul_ps (a.v, b.v), c.v); }
+        static Vec truncate (Vec x) { return _mm_cvtepi32_ps (_mm_cvttps_epi32 (x.v)); }
+
+        // no gather before AVX2, so the lanes get read one by one
+        static Vec gather (const float* table, Vec index)
+        {
+            alignas (16) int lanes[size];
+            _mm_store_si128 ((__m128i*) lanes, _mm_cvttps_epi32 (index.v));
+            return _mm_setr_ps (table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]);
+        }
+    };
+
+    // out here rather than as friends, GCC doesn't apply the target pragma to friends defined in a class
+    inline Vec operator+ (Vec a, Vec b) { return _mm_add_ps (a.v, b.v); }
+    inline Vec operator- (Vec a, Vec b) { return _mm_sub_ps (a.v, b.v); }
+    inline Vec operator* (Vec a, Vec b) { return _mm_mul_ps (a.v, b.v); }
+    inline Vec operator/ (Vec a, Vec b) { return _mm_div_ps (a.v, b.v); }
+}
+
+#include "DspKernelsImpl.h"
+
+namespace
+{
+    template struct Kernels<Vec>;
+}
+
+#if defined (__clang__)
+ #pragma clang attribute pop
+#elif defined (__GNUC__)
+ #pragma GCC pop_options
+#endif
+
+const DspKernels::Table* DspKernels::Variants::sse2() noexcept
+{
+    return &Kernels<Vec>::table;
+}
+
+#else
+
+const DspKernels::Table* DspKernels::Variants::sse2() noexcept
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ ==============================================================================
+
+ FastTanh.h
+ Vectorised tanh approximation for the clipper stages.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "DspKernels.h"
+#include "FastTanhApproximation.h"
+
+// The approximation and its error spec are in FastTanhApproximation.h, this adds the
+// scalar version and the block call that goes through DspKernels
+namespace FastTanh
+{
+    // scalar lane, for single values
+    struct Scalar
+    {
+        static constexpr int size = 1;
+        float v;
+
+        Scalar (float x) : v (x) {}
+        static Scalar load (const float* p) { return *p; }
+        void store (float* p) const { *p = v; }
+
+        friend Scalar operator+ (Scalar a, Scalar b) { return a.v + b.v; }
+        friend Scalar operator- (Scalar a, Scalar b) { return a.v - b.v; }
+        friend Scalar operator* (Scalar a, Scalar b) { return a.v * b.v; }
+        friend Scalar operator/ (Scalar a, Scalar b) { return a.v / b.v; }
+        static Scalar clamp (Scalar x, Scalar lo, Scalar hi) { return std::min (std::max (x.v, lo.v), hi.v); }
+    };
+
+    inline float process (float x)
+    {
+        return approximate (Scalar (x)).v;
+    }
+
+    // data[i] = outGain * tanh (inGain * data[i] + inBias) + outBias
+    // which covers both clipper curves without a call per sample
+    // (the SIMD versions are in DspKernels, the widest one the CPU has gets used)
+    inline void processAffine (float* data, int numSamples, float inGain, float inBias, float outGain, float outBias)
+    {
+        DspKernels::get().tanhAffine (data, numSamples, inGain, inBias, outGain, outBias);
+    }
+}
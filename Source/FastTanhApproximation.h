@@ -0,0 +1,68 @@
+/*
+ ==============================================================================
+
+ FastTanhApproximation.h
+ The tanh approximation itself, shared by FastTanh.h and the SIMD kernels.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+// Only constants and a template in here, nothing else: DspKernelsImpl.h includes it inside each
+// instruction set's target pragma, and a plain inline function would get one copy kept by the
+// linker for the whole plugin, possibly the AVX one (see DspKernelsImpl.h)
+//
+// tanh(x) ~= x * P(x^2) / Q(x^2), odd 13/6 rational (same fit Eigen uses for float),
+// with the input clamped to +-7.9053 where float tanh has already rounded to +-1
+//
+// Error spec (measured against double std::tanh over floats in [-10, 10], beyond that it's clamped):
+//   max absolute error    4.1e-7 (about 3.5 ulp of 1.0, worst around |x| = 5.8)
+//   max relative error    4.1e-7 for |x| >= 1e-30, denormal inputs underflow towards 0
+//   output is odd and never leaves [-1, 1], it is only monotonic to within 4.8e-7
+// Which is way below anything you could hear after 15-45 dB of fuzz.
+namespace FastTanh
+{
+    namespace Coefficients
+    {
+        constexpr float inputLimit = 7.90531110763549805f;
+
+        constexpr float alpha1 = 4.89352455891786e-03f;
+        constexpr float alpha3 = 6.37261928875436e-04f;
+        constexpr float alpha5 = 1.48572235717979e-05f;
+        constexpr float alpha7 = 5.12229709037114e-08f;
+        constexpr float alpha9 = -8.60467152213735e-11f;
+        constexpr float alpha11 = 2.00018790482477e-13f;
+        constexpr float alpha13 = -2.76076847742355e-16f;
+
+        constexpr float beta0 = 4.89352518554385e-03f;
+        constexpr float beta2 = 2.26843463243900e-03f;
+        constexpr float beta4 = 1.18534705686654e-04f;
+        constexpr float beta6 = 1.19825839466702e-06f;
+    }
+
+    // The approximation written once for anything with + * / and clamp,
+    // instantiated for plain floats in FastTanh.h and for each instruction set's SIMD wrapper in DspKernels
+    template <typename Vec>
+    inline Vec approximate (Vec x)
+    {
+        using namespace Coefficients;
+
+        x = Vec::clamp (x, Vec (-inputLimit), Vec (inputLimit));
+        const Vec x2 = x * x;
+
+        Vec p = x2 * Vec (alpha13) + Vec (alpha11);
+        p = x2 * p + Vec (alpha9);
+        p = x2 * p + Vec (alpha7);
+        p = x2 * p + Vec (alpha5);
+        p = x2 * p + Vec (alpha3);
+        p = x2 * p + Vec (alpha1);
+        p = x * p;
+
+        Vec q = x2 * Vec (beta6) + Vec (beta4);
+        q = x2 * q + Vec (beta2);
+        q = x2 * q + Vec (beta0);
+
+        return p / q;
+    }
+}
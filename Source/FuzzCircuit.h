@@ -0,0 +1,421 @@
+/*
+ ==============================================================================
+
+ FuzzCircuit.h
+ Wave digital filter model of the pedal's circuit, the "Circuit" engine.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include <cmath>
+
+// Wave digital building blocks, just the few sections this circuit needs. Each one is worked out
+// by hand for its topology rather than wired up from generic adaptors, so a whole section inlines
+// down to a handful of multiply-adds.
+// Voltage waves throughout: a = v + R i goes into an element, b = v - R i comes back out (i into
+// the element). Capacitors use the bilinear transform: port resistance T / 2C and b[n] = a[n - 1].
+// Seen from the rest of the circuit, a capacitor is then just its last wave z behind a resistor
+namespace Wdf
+{
+    // Wright omega, w + log w = x: a first guess (D'Angelo et al.'s cubic in the middle, the
+    // asymptotes either side) then one step of Fritsch's iteration, which takes it to about 1e-5.
+    // Past 16 the asymptotic series alone is already within 6e-5 (a few uV at the diodes), and
+    // that's where a hard driven clipper spends most of its time, so that's a single log.
+    // Otherwise a log or two and at most one exp per call, with no loop to converge.
+    // The exp side starts at -2 rather than where the cubic was fitted from (-3.34), down there the
+    // cubic gets too close to zero for the log
+    template <typename T>
+    inline T wrightOmega (T x) noexcept
+    {
+        constexpr T x1 = T (-2.0);
+        constexpr T x2 = T (8.0);
+        constexpr T x3 = T (16.0);
+        constexpr T a = T (-1.314293149877800e-3);
+        constexpr T b = T (4.775931364975583e-2);
+        constexpr T c = T (3.631952663804445e-1);
+        constexpr T d = T (6.313183464296682e-1);
+
+        T w;
+
+        if (x >= x3)
+        {
+            const T l = std::log (x);
+            const T inverse = T (1) / x;
+
+            return x - l + l * inverse * (T (1) + inverse * (T (0.5) * (l - T (2))
+                                                               + inverse * (l * (T (2) * l - T (9)) + T (6)) / T (6)));
+        }
+
+        if (x < x1)
+            w = std::exp (x);
+        else if (x < x2)
+            w = d + x * (c + x * (b + x * a));
+        else
+            w = x - std::log (x);
+
+        const T r = x - w - std::log (w);
+        const T q = T (2) * (T (1) + w) * (T (1) + w + T (2.0 / 3.0) * r);
+
+        return w + w * r * (q - r) / ((T (1) + w) * (q - T (2) * r));
+    }
+
+    // Shockley diode (a string of identical ones in series behaves like one with n times the
+    // thermal voltage)
+    struct DiodeModel
+    {
+        double saturationCurrent = 2.52e-9;     // 1N914
+        double thermalVoltage = 0.02585 * 1.752; // kT/q times the ideality factor
+        int count = 1;
+    };
+
+    // Antiparallel diodes (or diode strings) at the root of a tree with port resistance R.
+    // Whichever side a pushes forward conducts, the other counts as off, which is exact
+    // to well below audibility once the voltage is past a few mV (Werner et al. 2016).
+    // The two sides can differ, and that's where asymmetric clipping comes from
+    template <typename T>
+    struct DiodePair
+    {
+        void setup (double portResistance, const DiodeModel& forward, const DiodeModel& reverse) noexcept
+        {
+            positive = makeSide (portResistance, forward);
+            negative = makeSide (portResistance, reverse);
+        }
+
+        T reflect (T a) const noexcept
+        {
+            const Side& side = a >= T (0) ? positive : negative;
+            const T magnitude = std::abs (a);
+            const T b = magnitude + side.twoRIs - side.twoVt * wrightOmega (side.offset + magnitude * side.inverseVt);
+
+            return a >= T (0) ? b : -b;
+        }
+
+        private:
+        struct Side
+        {
+            T twoRIs = 0, twoVt = 0, inverseVt = 0, offset = 0;
+        };
+
+        Side positive, negative;
+
+        static Side makeSide (double portResistance, const DiodeModel& diode) noexcept
+        {
+            const double vt = diode.thermalVoltage * diode.count;
+            const double rIs = portResistance * diode.saturationCurrent;
+
+            return { T (2.0 * rIs), T (2.0 * vt), T (1.0 / vt), T (std::log (rIs / vt) + rIs / vt) };
+        }
+    };
+
+    // Diode clipper: the source through a series resistor into a capacitor, with the diodes
+    // across it (the transistor stage's output and its clipping diodes). One parallel adaptor
+    // joins the source and capacitor and faces the diodes at the root
+    template <typename T>
+    struct DiodeClipper
+    {
+        double resistance = 2200.0;
+        double capacitance = 10.0e-9;
+        DiodeModel forward, reverse;
+
+        void prepare (double sampleRate) noexcept
+        {
+            const double sourceConductance = 1.0 / resistance;
+            const double capacitorConductance = 2.0 * capacitance * sampleRate;
+            const double total = sourceConductance + capacitorConductance;
+
+            sourceShare = T (sourceConductance / total);
+            capacitorShare = T (capacitorConductance / total);
+            diodes.setup (1.0 / total, forward, reverse);
+        }
+
+        void reset() noexcept { z = T (0); }
+
+        T processSample (T input) noexcept
+        {
+            const T up = sourceShare * input + capacitorShare * z;
+            const T v = T (0.5) * (up + diodes.reflect (up));
+
+            z = T (2) * v - z;
+            return v;
+        }
+
+        T z = T (0);
+        T sourceShare = T (0), capacitorShare = T (0);
+        DiodePair<T> diodes;
+    };
+
+    // Coupling capacitor in series, resistor to ground: one loop, high-pass across the resistor
+    template <typename T>
+    struct RcHighPass
+    {
+        void prepare (double sampleRate, double resistance, double capacitance) noexcept
+        {
+            const double capacitorResistance = 1.0 / (2.0 * capacitance * sampleRate);
+            outputShare = T (resistance / (resistance + capacitorResistance));
+        }
+
+        void reset() noexcept { z = T (0); }
+
+        T processSample (T input) noexcept
+        {
+            const T output = outputShare * (input - z);
+
+            z = T (2) * (input - output) - z;
+            return output;
+        }
+
+        T z = T (0);
+        T outputShare = T (0);
+    };
+
+    // Series resistor, capacitor to ground: one loop, low-pass across the capacitor
+    template <typename T>
+    struct RcLowPass
+    {
+        void prepare (double sampleRate, double resistance, double capacitance) noexcept
+        {
+            const double capacitorResistance = 1.0 / (2.0 * capacitance * sampleRate);
+            capacitorShare = T (capacitorResistance / (resistance + capacitorResistance));
+        }
+
+        void reset() noexcept { z = T (0); }
+
+        T processSample (T input) noexcept
+        {
+            const T output = z + capacitorShare * (input - z);
+
+            z = T (2) * output - z;
+            return output;
+        }
+
+        T z = T (0);
+        T capacitorShare = T (0);
+    };
+
+    // The passive tone stack: a low-pass branch (series R, shunt C) and a high-pass branch
+    // (series C, shunt R) from the same source, with the tone pot across their outputs and the
+    // wiper as the output. The pot bridges the two branches, so this isn't a series/parallel tree.
+    // It's one R-type junction instead, solved by nodal analysis at the two branch nodes. The
+    // wiper isn't loaded and the pot's total stays the same, so the junction doesn't depend on the
+    // knob at all. The knob only picks the blend of the two node voltages, and that makes
+    // moving it free (no coefficients to recompute, nothing to zipper)
+    template <typename T>
+    struct ToneStack
+    {
+        double lowPassResistance = 39.0e3;
+        double lowPassCapacitance = 10.0e-9;
+        double highPassCapacitance = 4.0e-9;
+        double highPassResistance = 22.0e3;
+        double potResistance = 100.0e3;
+
+        void prepare (double sampleRate) noexcept
+        {
+            const double g1 = 1.0 / lowPassResistance;
+            const double gc1 = 2.0 * lowPassCapacitance * sampleRate;
+            const double gc2 = 2.0 * highPassCapacitance * sampleRate;
+            const double g2 = 1.0 / highPassResistance;
+            const double gp = 1.0 / potResistance;
+
+            // [ g1 + gc1 + gp   -gp            ] [ vLow  ]   [ g1 vin + gc1 z1   ]
+            // [ -gp             gc2 + g2 + gp  ] [ vHigh ] = [ gc2 (vin - z2)    ]
+            const double m00 = g1 + gc1 + gp, m11 = gc2 + g2 + gp, m01 = -gp;
+            const double det = m00 * m11 - m01 * m01;
+            const double i00 = m11 / det, i11 = m00 / det, i01 = -m01 / det;
+
+            lowFromInput = T (i00 * g1 + i01 * gc2);
+            lowFromZ1 = T (i00 * gc1);
+            lowFromZ2 = T (-i01 * gc2);
+            highFromInput = T (i01 * g1 + i11 * gc2);
+            highFromZ1 = T (i01 * gc1);
+            highFromZ2 = T (-i11 * gc2);
+        }
+
+        void reset() noexcept { z1 = z2 = T (0); }
+
+        // tone 0 = the wiper at the low-pass end
+        T processSample (T input, T tone) noexcept
+        {
+            const T low = lowFromInput * input + lowFromZ1 * z1 + lowFromZ2 * z2;
+            const T high = highFromInput * input + highFromZ1 * z1 + highFromZ2 * z2;
+
+            z1 = T (2) * low - z1;
+            z2 = T (2) * (input - high) - z2;
+
+            return low + tone * (high - low);
+        }
+
+        T z1 = T (0), z2 = T (0);
+        T lowFromInput = T (0), lowFromZ1 = T (0), lowFromZ2 = T (0);
+        T highFromInput = T (0), highFromZ1 = T (0), highFromZ2 = T (0);
+    };
+}
+
+// The pedal as its circuit: coupling cap, two transistor gain stages clipping into diodes,
+// the passive tone stack, and the output's RC low-pass, all as wave digital filters.
+// The transistors themselves are ideal gains. SUSTAIN and VOLUME stay as the engine's own gain
+// stages, and the diodes, caps and tone stack do the shaping. The nonlinear part is solved in
+// closed form (Wright omega), so every sample costs the same.
+// Runs one channel, in three pieces so the engine can oversample the clippers only.
+//
+// Cost budget, per channel:
+//  - base rate, every sample: input HPF, tone stack and output LPF, about 20 flops
+//  - clippers, every oversampled sample: 2 diode clippers, each one Wright omega (a log, or an
+//    exp and a log when it's barely conducting) and about 15 flops
+// The clippers dominate, and they're serial (every sample needs the last one's capacitor state),
+// so they run at the transcendentals' latency rather than their throughput. Measured through the
+// whole engine (x86-64 server, gcc -O2, float, one channel at 48 kHz, default settings), the
+// classic engine in brackets:
+//      off  93 ns/sample  (29)       2x  179 ns/sample  (43)
+//      4x  325 ns/sample  (69)       8x  629 ns/sample  (122)
+// so about 3x the classic engine without oversampling, rising to 5x at 8x. Per channel at 48 kHz
+// that's about 0.45% of one core with oversampling off, 1.6% at 4x and 3% at 8x, which is why
+// the quality tiers only take its oversampling down
+template <typename SampleType>
+class FuzzCircuit
+{
+    public:
+    // the two gain stages and their diodes, the only part that runs oversampled
+    struct Clippers
+    {
+        Clippers()
+        {
+            // first stage clips into a matched pair, the second has two diodes in series
+            // one way round, so it clips later on the negative side (even harmonics)
+            second.reverse.count = 2;
+        }
+
+        void prepare (double sampleRate) noexcept
+        {
+            first.prepare (sampleRate);
+            second.prepare (sampleRate);
+        }
+
+        void reset() noexcept
+        {
+            first.reset();
+            second.reset();
+        }
+
+        void processSamples (SampleType* data, int numSamples) noexcept
+        {
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = second.processSample (SampleType (interstageGain) * first.processSample (data[i]));
+        }
+
+        // second transistor stage, about 18 dB
+        static constexpr double interstageGain = 8.0;
+
+        Wdf::DiodeClipper<SampleType> first, second;
+    };
+
+    void prepare (double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+
+        // 100 nF into 53k is the same 30 Hz corner as the classic engine's input HPF
+        inputHighPass.prepare (sampleRate, 53.0e3, 100.0e-9);
+        toneStack.prepare (sampleRate);
+        outputLowPass.prepare (sampleRate, 10.0e3, 2.9e-9);     // 5.5 kHz
+
+        smoothedTone.reset (sampleRate, 0.03);
+        smoothedTone.setCurrentAndTargetValue (tone);
+
+        oversamplingFactor = 1;
+        clippers.prepare (sampleRate);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        inputHighPass.reset();
+        clippers.reset();
+        toneStack.reset();
+        outputLowPass.reset();
+        smoothedTone.setCurrentAndTargetValue (tone);
+    }
+
+    void resetToneStack() noexcept { toneStack.reset(); }
+
+    // the clippers' capacitors depend on the rate they run at (state is kept, it's only a few
+    // samples of ring)
+    void setOversamplingFactor (int factor) noexcept
+    {
+        if (factor == oversamplingFactor)
+            return;
+
+        oversamplingFactor = factor;
+        clippers.prepare (sampleRate * factor);
+    }
+
+    void setTone (SampleType newTone) noexcept
+    {
+        tone = juce::jlimit (SampleType (0), SampleType (1), newTone);
+        smoothedTone.setTargetValue (tone);
+    }
+
+    // coupling cap, at the base rate
+    void processInput (SampleType* data, int numSamples) noexcept
+    {
+        auto hpf = inputHighPass;
+
+        for (int i = 0; i < numSamples; ++i)
+            data[i] = hpf.processSample (data[i]);
+
+        inputHighPass = hpf;
+    }
+
+    Clippers& getClippers() noexcept { return clippers; }
+
+    // tone stack (blended in by toneMixRamp while the tone switch fades, nullptr = all the way
+    // in, or skipped entirely with toneEnabled off) and the output LPF, at the base rate
+    void processOutput (SampleType* data, int numSamples, bool toneEnabled, const SampleType* toneMixRamp) noexcept
+    {
+        auto lpf = outputLowPass;
+
+        if (toneMixRamp != nullptr)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const SampleType x = data[i];
+                const SampleType shaped = SampleType (toneStackMakeup) * toneStack.processSample (x, smoothedTone.getNextValue());
+                data[i] = lpf.processSample (x + toneMixRamp[i] * (shaped - x));
+            }
+        }
+        else if (toneEnabled)
+        {
+            auto stack = toneStack;
+
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = lpf.processSample (SampleType (toneStackMakeup) * stack.processSample (data[i], smoothedTone.getNextValue()));
+
+            toneStack = stack;
+        }
+        else
+        {
+            smoothedTone.skip (numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = lpf.processSample (data[i]);
+        }
+
+        outputLowPass = lpf;
+    }
+
+    private:
+    // the tone stack loses about 8 dB in the mids at noon, the recovery stage after it in the
+    // real pedal makes that back
+    static constexpr double toneStackMakeup = 2.5;
+
+    double sampleRate = 44100.0;
+    int oversamplingFactor = 1;
+
+    Wdf::RcHighPass<SampleType> inputHighPass;
+    Clippers clippers;
+    Wdf::ToneStack<SampleType> toneStack;
+    Wdf::RcLowPass<SampleType> outputLowPass;
+
+    SampleType tone = SampleType (0.5);
+    juce::SmoothedValue<SampleType> smoothedTone { SampleType (0.5) };
+};
@@ -0,0 +1,1262 @@
+/*
+ ==============================================================================
+
+ FuzzColaDsp.cpp
+ The pedal's signal path, built for float and double.
+
+ ==============================================================================
+ */
+
+#include "FuzzColaDsp.h"
+
+// the audio thread's done with both of these (or never got them), so they go here
+template <typename SampleType>
+FuzzColaDsp<SampleType>::~FuzzColaDsp()
+{
+    delete pendingCabinet.exchange (nullptr);
+    delete retiredCabinet.exchange (nullptr);
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::prepare (double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    
+    juce::dsp::ProcessSpec spec;
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = (juce::uint32) maximumBlockSize;
+    spec.numChannels = 1; // every chain is mono
+    
+    for (std::size_t i = 0; i < chains.size(); ++i)
+    {
+        chains[i].prepare(spec);
+        
+        // Input booster / Sustain pre-gain
+        auto& inputGain = juce::dsp::get<InputGainIndex> (chains[i]);
+        inputGain.setRampDurationSeconds (0.001);
+        
+        // Input high-pass
+        auto& preFilter = juce::dsp::get<PreHighPassIndex> (chains[i]);
+        preFilter.reset();
+        preFilter.setCoefficients (SvfCoefficients<SampleType>::makeHighPass (sampleRate, 30.0));
+        
+        // Clipping stages, both tanh-based (the curves live in ClipperShapers.h)
+        // Stage 1: soft, pretty symmetric pre-shaping
+        // Stage 2: offset tanh for some even harmonics
+        // their mode (fast tanh / ADAA) gets set in updateAntiAliasing()
+        
+        // Global post low-pass to smooth the very top fizz
+        // I added as i noticed that the real pedal doesnt have much high end above like 5.5 kHz
+        auto& postLowPass = juce::dsp::get<PostLowPassIndex> (chains[i]);
+        postLowPass.reset();
+        postLowPass.setCutoff (sampleRate, 5500.0);
+        
+        // Output gain (Volume)
+        auto& outputGain = juce::dsp::get<OutputGainIndex> (chains[i]);
+        outputGain.setRampDurationSeconds(0.001);
+        
+        circuits[i].prepare (sampleRate);
+    }
+    
+    // shared between all instances, only the first one to get here actually builds it
+    if (clipTable == nullptr)
+        clipTable = CompositeClipTable::getShared();
+    
+    // all oversampling modes get their buffers now so switching never allocates
+    oversampler.prepare ((int) chains.size(), maximumBlockSize);
+    outgoingOversampler.prepare ((int) chains.size(), maximumBlockSize);
+    adaaOrder = -1;
+    forceParameterUpdate = true;
+    chainsMatch = true;
+    rightChainIdle = false;
+    activity = {};
+    toneMix.reset (sampleRate, 0.01);
+    qualityMix.reset (sampleRate, qualityFadeSeconds);
+    qualityMix.setCurrentAndTargetValue (SampleType (1));
+    cabinetMix.reset (sampleRate, cabinetFadeSeconds);
+    cabinetMix.setCurrentAndTargetValue (1.0f);
+    cabinet->reset();
+    
+    updateTailLength();
+    
+    // Bypass: the history has to cover the worst case latency (the dry side gets delayed by it)
+    // and the stretch of input the chains get primed with when the pedal comes back on
+    double maxLatency = 0.0;
+    
+    for (int stages = 0; stages <= HalfBandOversampler<SampleType>::maxStages; ++stages)
+        maxLatency = juce::jmax (maxLatency,
+                                 oversampler.getLatencyInSamples (stages, HalfBandOversampler<SampleType>::FilterType::iir),
+                                 oversampler.getLatencyInSamples (stages, HalfBandOversampler<SampleType>::FilterType::linearPhase));
+    
+    // the quality tier padding never has to cover more than the full latency either
+    for (std::size_t i = 0; i < (std::size_t) maxChannels; ++i)
+    {
+        padding[i].prepare ((int) std::ceil (maxLatency) + 1);
+        outgoing[i].padding.prepare ((int) std::ceil (maxLatency) + 1);
+    }
+    
+    // priming can be a whole chunk plus primeSamples behind, and the ring has to hold all of it
+    primeSamples = (int) std::ceil (primeSeconds * sampleRate);
+    const int historySize = juce::nextPowerOfTwo (juce::jmax (primeSamples + oversampler.getMaximumBlockSize() + 1,
+                                                              (int) std::ceil (maxLatency) + 2 + 1));
+    historyMask = historySize - 1;
+    historyPosition = 0;
+    
+    for (std::size_t i = 0; i < (std::size_t) maxChannels; ++i)
+    {
+        inputHistory[i].assign ((size_t) historySize, SampleType (0));
+        dryBuffers[i].assign ((size_t) oversampler.getMaximumBlockSize(), SampleType (0));
+    }
+    
+    wetMix.reset (sampleRate, bypassFadeSeconds);
+    wetMix.setCurrentAndTargetValue (lastPedalOn ? SampleType (1) : SampleType (0));
+    primePending = priming = false;
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::reset()
+{
+    for (auto& chain : chains)
+        chain.reset();
+    
+    for (auto& circuit : circuits)
+        circuit.reset();
+    
+    oversampler.reset();
+    forceParameterUpdate = true;
+    chainsMatch = true;
+    rightChainIdle = false;
+    activity = {};
+    
+    for (auto& delay : padding)
+        delay.reset();
+    
+    qualityMix.setCurrentAndTargetValue (SampleType (1));
+    
+    // a cabinet fade just finishes and one that's waiting goes straight in, nothing's playing
+    // to fade from (the outgoing one gets handed back as usual)
+    updateCabinet (true);
+    cabinet->reset();
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::setParameters (const FuzzColaParameters& parameters)
+{
+    // Footswitch: fades rather than cuts, and if the pedal sat fully bypassed
+    // its state is stale, so it gets cleared and primed first, the fade in waits for that.
+    // Switching engines goes the same way, out to the dry signal, swapped over there and back in
+    // primed (both engines use the one oversampler, so they can't run side by side to crossfade)
+    const bool fullyDry = ! wetMix.isSmoothing() && wetMix.getCurrentValue() == SampleType (0);
+    
+    if (parameters.circuitModel != circuitModel && (fullyDry || forceParameterUpdate))
+    {
+        circuitModel = parameters.circuitModel;
+        
+        // half primed is no use to the other engine, it starts over
+        primePending = primePending || priming;
+        priming = false;
+    }
+    
+    const bool wetWanted = parameters.pedalOn && parameters.circuitModel == circuitModel;
+    const bool wetComing = primePending || priming || wetMix.getTargetValue() > SampleType (0.5);
+    
+    if (wetWanted != wetComing)
+    {
+        if (wetWanted && fullyDry)
+            primePending = true;
+        else if (! wetWanted && (primePending || priming))
+            primePending = priming = false;
+        else
+            wetMix.setTargetValue (wetWanted ? SampleType (1) : SampleType (0));
+    }
+    
+    lastPedalOn = parameters.pedalOn;
+    
+    // what's running sets the anti-aliasing, the one being switched to waits its turn
+    FuzzColaParameters running = parameters;
+    running.circuitModel = circuitModel;
+    updateAntiAliasing (running);
+    
+    const float sustain = parameters.sustain;
+    const float tone = parameters.tone;
+    const float volumeDb = parameters.volumeDb;
+    const bool  toneEnabled = parameters.toneEnabled;
+    
+    // nothing moved, nothing to do (the usual case)
+    if (! forceParameterUpdate && sustain == lastSustain && volumeDb == lastVolumeDb && tone == lastTone
+        && toneEnabled == lastToneEnabled)
+        return;
+    
+    // Tone switch: the fused engine swaps to the variant without the shelves, with a short
+    // wet/dry fade so it doesn't click. Coming back in, the shelves start from clean state
+    // rather than whatever they held when they were switched off
+    if (forceParameterUpdate)
+    {
+        toneMix.setCurrentAndTargetValue (toneEnabled ? SampleType (1) : SampleType (0));
+    }
+    else if (toneEnabled != lastToneEnabled)
+    {
+        if (toneEnabled && toneMix.getCurrentValue() == SampleType (0))
+        {
+            for (auto& chain : chains)
+                juce::dsp::get<ToneStackIndex> (chain).reset();
+            
+            for (auto& circuit : circuits)
+                circuit.resetToneStack();
+        }
+        
+        toneMix.setTargetValue (toneEnabled ? SampleType (1) : SampleType (0));
+    }
+    
+    // Gives the pedal some built-in dirt even at minimum
+    const float sustainDb = juce::jmap (sustain, 0.0f, 1.0f,
+                                        minSustainDb, maxSustainDb);
+    
+    // ye old processor chain
+    for (std::size_t i = 0; i < chains.size(); ++i)
+    {
+        Chain& chain = chains[i];
+        
+        auto& inputGain  = juce::dsp::get<InputGainIndex> (chain);
+        auto& toneStage = juce::dsp::get<ToneStackIndex> (chain);
+        auto& outputGain = juce::dsp::get<OutputGainIndex> (chain);
+        
+        if (forceParameterUpdate || sustain != lastSustain)
+            inputGain.setGainDecibels ((SampleType) sustainDb);
+        
+        if (forceParameterUpdate || volumeDb != lastVolumeDb)
+            outputGain.setGainDecibels ((SampleType) volumeDb);
+        
+        // setTone only touches the shelves when the value differs, and then in place
+        toneStage.setTone ((SampleType) tone);
+        circuits[i].setTone ((SampleType) tone);
+        
+    }
+    
+    lastSustain = sustain;
+    lastVolumeDb = volumeDb;
+    lastTone = tone;
+    lastToneEnabled = toneEnabled;
+    forceParameterUpdate = false;
+}
+
+// Picks the oversampling and ADAA modes for the current quality tier and works out the latency
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::updateAntiAliasing (const FuzzColaParameters& parameters)
+{
+    const FuzzColaParameters settings = applyQualityTier (parameters, parameters.qualityTier);
+    const auto filterType = settings.linearPhaseOversampling ? HalfBandOversampler<SampleType>::FilterType::linearPhase
+                                                             : HalfBandOversampler<SampleType>::FilterType::iir;
+    
+    const ShaperMode mode = settings.adaaOrder == 1 ? ShaperMode::adaaFirstOrder
+                          : settings.adaaOrder == 2 ? ShaperMode::adaaSecondOrder
+                          : settings.exactClippers  ? ShaperMode::exact
+                                                    : ShaperMode::fast;
+    
+    // Tier change: what's running now hands over to the outgoing path before anything gets switched
+    // (a change of the settings themselves just switches, same as it always has)
+    const bool setupChanges = juce::jlimit (0, HalfBandOversampler<SampleType>::maxStages, settings.oversamplingStages) != oversampler.getNumStages()
+                           || filterType != oversampler.getFilterType() || mode != shaperMode || settings.useClipTable != useClipTable;
+    
+    if (! forceParameterUpdate && parameters.qualityTier != qualityTier && setupChanges)
+        beginQualityFade();
+    
+    qualityTier = parameters.qualityTier;
+    useClipTable = settings.useClipTable;
+    oversampler.setMode (settings.oversamplingStages, filterType);
+    
+    // the stages reset their own history when the mode actually changes
+    if (settings.adaaOrder != adaaOrder || mode != shaperMode)
+    {
+        adaaOrder = settings.adaaOrder;
+        shaperMode = mode;
+        
+        for (auto& chain : chains)
+        {
+            juce::dsp::get<Clipper1Index> (chain).setMode (mode);
+            juce::dsp::get<Clipper2Index> (chain).setMode (mode);
+        }
+    }
+    
+    // The reported latency is the most any tier needs (tier 0, in practice, since they only get
+    // cheaper from there), whatever the tier running now saves goes into the padding
+    double maxLatency = 0.0;
+    
+    for (FuzzColaParameters step = parameters;;)
+    {
+        maxLatency = juce::jmax (maxLatency, getPathLatency (step));
+        
+        if (! stepQualityDown (step))
+            break;
+    }
+    
+    latencySamples = (int) std::lround (maxLatency);
+    paddingSamples = juce::jmax (0, latencySamples - (int) std::lround (getPathLatency (settings)));
+}
+
+// Oversampler round trip plus both clippers' ADAA delay (at the oversampled rate)
+template <typename SampleType>
+double FuzzColaDsp<SampleType>::getPathLatency (const FuzzColaParameters& settings) const
+{
+    const int stages = juce::jlimit (0, HalfBandOversampler<SampleType>::maxStages, settings.oversamplingStages);
+    const auto filterType = settings.linearPhaseOversampling ? HalfBandOversampler<SampleType>::FilterType::linearPhase
+                                                             : HalfBandOversampler<SampleType>::FilterType::iir;
+    const int adaa = settings.circuitModel ? 0 : settings.adaaOrder;    // the circuit engine has no ADAA
+    double adaaLatency = 0.0;
+    
+    if (adaa == 1)
+        adaaLatency = AdaaShaper<SymmetricClipCurve>::getLatencyInSamples (AdaaShaper<SymmetricClipCurve>::Order::first)
+                    + AdaaShaper<OffsetClipCurve>::getLatencyInSamples (AdaaShaper<OffsetClipCurve>::Order::first);
+    else if (adaa == 2)
+        adaaLatency = AdaaShaper<SymmetricClipCurve>::getLatencyInSamples (AdaaShaper<SymmetricClipCurve>::Order::second)
+                    + AdaaShaper<OffsetClipCurve>::getLatencyInSamples (AdaaShaper<OffsetClipCurve>::Order::second);
+    
+    return oversampler.getLatencyInSamples (stages, filterType) + adaaLatency / (double) (1 << stages);
+}
+
+template <typename SampleType>
+FuzzColaParameters FuzzColaDsp<SampleType>::applyQualityTier (FuzzColaParameters parameters, int tier) noexcept
+{
+    for (int i = 0; i < tier; ++i)
+        if (! stepQualityDown (parameters))
+            break;
+    
+    return parameters;
+}
+
+template <typename SampleType>
+int FuzzColaDsp<SampleType>::getNumQualityTiers (const FuzzColaParameters& parameters) noexcept
+{
+    int numTiers = 1;
+    
+    for (auto step = parameters; stepQualityDown (step);)
+        ++numTiers;
+    
+    return numTiers;
+}
+
+// One notch cheaper, false once it's already as cheap as it gets
+// (2x hands over to ADAA, which gets most of the aliasing back for a fraction of the cost)
+template <typename SampleType>
+bool FuzzColaDsp<SampleType>::stepQualityDown (FuzzColaParameters& parameters) noexcept
+{
+    // the circuit engine only has its oversampling to give up
+    if (parameters.circuitModel)
+    {
+        if (parameters.oversamplingStages == 0)
+            return false;
+        
+        --parameters.oversamplingStages;
+    }
+    else if (parameters.oversamplingStages > 1)
+    {
+        --parameters.oversamplingStages;
+    }
+    else if (parameters.oversamplingStages == 1)
+    {
+        parameters.oversamplingStages = 0;
+        parameters.adaaOrder = juce::jmax (1, parameters.adaaOrder);
+    }
+    else if (parameters.adaaOrder > 0)
+    {
+        --parameters.adaaOrder;
+    }
+    else if (parameters.exactClippers)
+    {
+        parameters.exactClippers = false;
+    }
+    else if (! parameters.useClipTable)
+    {
+        parameters.useClipTable = true;
+    }
+    else
+    {
+        return false;
+    }
+    
+    return true;
+}
+
+// The setup that's running now carries on in the outgoing path, state and all, and fades out
+// while the new one (starting from clean state) fades in
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::beginQualityFade()
+{
+    outgoingOversampler.copyStateFrom (oversampler);
+    
+    for (std::size_t i = 0; i < chains.size(); ++i)
+    {
+        outgoing[i].clipper1 = juce::dsp::get<Clipper1Index> (chains[i]);
+        outgoing[i].clipper2 = juce::dsp::get<Clipper2Index> (chains[i]);
+        outgoing[i].circuitClippers = circuits[i].getClippers();
+        outgoing[i].padding = padding[i];
+    }
+    
+    outgoingUsesTable = useClipTable && adaaOrder == 0;
+    outgoingPaddingSamples = paddingSamples;
+    
+    qualityMix.setCurrentAndTargetValue (SampleType (0));
+    qualityMix.setTargetValue (SampleType (1));
+}
+
+// the outgoing setup over outgoingTile, same steps as processClippers
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processOutgoingClippers (std::size_t channel, int length)
+{
+    auto& path = outgoing[channel];
+    
+    SampleType* up = outgoingOversampler.processUp ((int) channel, outgoingTile.data(), length);
+    const int upLength = length * outgoingOversampler.getFactor();
+    
+    if (circuitModel)
+    {
+        path.circuitClippers.processSamples (up, upLength);
+    }
+    else if (outgoingUsesTable)
+    {
+        clipTable->processBlock (up, upLength);
+    }
+    else
+    {
+        path.clipper1.processSamples (up, upLength);
+        path.clipper2.processSamples (up, upLength);
+    }
+    
+    outgoingOversampler.processDown ((int) channel, outgoingTile.data(), length);
+    path.padding.process (outgoingTile.data(), length, outgoingPaddingSamples);
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::PaddingDelay::prepare (int maximumDelay)
+{
+    buffer.assign ((size_t) juce::nextPowerOfTwo (juce::jmax (2, maximumDelay + 1)), SampleType (0));
+    mask = (int) buffer.size() - 1;
+    position = 0;
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::PaddingDelay::reset() noexcept
+{
+    std::fill (buffer.begin(), buffer.end(), SampleType (0));
+    position = 0;
+}
+
+// keeps writing at no delay too, so the history is there if the delay goes up
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::PaddingDelay::process (SampleType* data, int numSamples, int delay) noexcept
+{
+    jassert (delay <= mask);
+    
+    for (int i = 0; i < numSamples; ++i)
+    {
+        buffer[(size_t) position] = data[i];
+        data[i] = buffer[(size_t) ((position - delay) & mask)];
+        position = (position + 1) & mask;
+    }
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::setImpulseResponse (std::shared_ptr<const ImpulseResponse> ir)
+{
+    releaseRetiredCabinet();
+    
+    // one that came in since the last block and never got picked up is just replaced
+    auto next = std::make_unique<PartitionedConvolver> (std::move (ir));
+    delete pendingCabinet.exchange (next.release());
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::releaseRetiredCabinet()
+{
+    delete retiredCabinet.exchange (nullptr);
+}
+
+// Start of every block: hands the outgoing convolver back once its fade is done, then takes
+// a new one if there is one, fading over to it (straight over for the reference chain)
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::updateCabinet (bool skipFade)
+{
+    if (skipFade && cabinetMix.isSmoothing())
+        cabinetMix.setCurrentAndTargetValue (1.0f);
+    
+    if (outgoingCabinet != nullptr && ! cabinetMix.isSmoothing())
+    {
+        PartitionedConvolver* expected = nullptr;
+        
+        // the last one hasn't been freed yet, this one waits its turn
+        if (! retiredCabinet.compare_exchange_strong (expected, outgoingCabinet.get()))
+            return;
+        
+        outgoingCabinet.release();
+    }
+    
+    if (outgoingCabinet != nullptr)
+        return;
+    
+    if (auto* next = pendingCabinet.exchange (nullptr))
+    {
+        outgoingCabinet = std::move (cabinet);
+        cabinet.reset (next);
+        
+        cabinetMix.setCurrentAndTargetValue (skipFade ? 1.0f : 0.0f);
+        cabinetMix.setTargetValue (1.0f);
+        
+        cabinetLength.store (cabinet->getLength(), std::memory_order_relaxed);
+        tailSamples = filterTailSamples + cabinet->getLength();
+    }
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::process (SampleType* const* channels, int numChannels, int numSamples)
+{
+    jassert (numChannels >= 1 && numChannels <= maxChannels);
+    
+    const std::size_t numChains = (std::size_t) juce::jlimit (1, maxChannels, numChannels);
+    
+    // oversampler scratch is sized for the prepared block size, so bigger host blocks get split
+    const int maxChunk = oversampler.getMaximumBlockSize();
+    const bool useReference = useReferenceChain.load (std::memory_order_relaxed);
+    
+    // the pedal just got switched back on after sitting bypassed, its state is from whenever that was,
+    // so it starts clean primeSamples back in the history and catches up from there
+    if (primePending)
+    {
+        reset();
+        primePending = false;
+        priming = true;
+        primePosition = (historyPosition - primeSamples) & historyMask;
+    }
+    
+    updateCabinet (useReference);
+    
+    for (int start = 0; start < numSamples; start += maxChunk)
+    {
+        const int chunk = juce::jmin (maxChunk, numSamples - start);
+        SampleType* chunkChannels[maxChannels] = {};
+        
+        for (std::size_t i = 0; i < numChains; ++i)
+            chunkChannels[i] = channels[i] + start;
+        
+        // Bypassed: just the input, delayed by the latency the pedal would have
+        if (! wetMix.isSmoothing() && wetMix.getTargetValue() == SampleType (0))
+        {
+            pushHistory (chunkChannels, numChains, chunk, chunkChannels);
+            
+            if (priming)
+                primeStep (numChains, 2 * chunk, useReference);
+            
+            continue;
+        }
+        
+        if (! wetMix.isSmoothing())
+        {
+            pushHistory (chunkChannels, numChains, chunk, nullptr);
+            processWet (chunkChannels, numChains, chunk, useReference);
+            continue;
+        }
+        
+        // Footswitch fade: the delayed dry input against the pedal, equal power so the level
+        // doesn't dip halfway through
+        SampleType* dryChannels[maxChannels] = {};
+        
+        for (std::size_t i = 0; i < numChains; ++i)
+        {
+            dryChannels[i] = dryBuffers[i].data();
+            std::copy (chunkChannels[i], chunkChannels[i] + chunk, dryChannels[i]);
+        }
+        
+        pushHistory (dryChannels, numChains, chunk, dryChannels);
+        processWet (chunkChannels, numChains, chunk, useReference);
+        
+        const SampleType halfPi = SampleType (1.57079632679489661923);
+        
+        for (int i = 0; i < chunk; ++i)
+        {
+            const SampleType position = wetMix.getNextValue() * halfPi;
+            const SampleType wetGain = std::sin (position);
+            const SampleType dryGain = std::cos (position);
+            
+            for (std::size_t c = 0; c < numChains; ++c)
+                chunkChannels[c][i] = wetGain * chunkChannels[c][i] + dryGain * dryChannels[c][i];
+        }
+    }
+}
+
+// The pedal itself on one chunk, with the dual mono and silence short cuts
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processWet (SampleType* const* chunkChannels, std::size_t numChains, int chunk, bool useReference)
+{
+    // Dual mono: with the same samples going into both chains (and both chains in the same
+    // state) the right one can only come out the same, so the left one runs alone and gets copied
+    const bool identicalInputs = numChains == 2 && samplesMatch (chunkChannels[0], chunkChannels[1], chunk);
+    const bool shareLeftChain = identicalInputs && (chainsMatch || rightChainIdle);
+    
+    // the right chain skipped everything since the split, so it takes over the left one's state
+    if (rightChainIdle && ! shareLeftChain)
+    {
+        copyLeftChainToRight();
+        rightChainIdle = false;
+    }
+    
+    const std::size_t numActive = shareLeftChain ? 1 : numChains;
+    
+    // Silence: a channel that's been quiet long enough for everything to ring out
+    // just outputs zeros until its input comes back
+    std::size_t running[maxChannels] = {};
+    std::size_t numRunning = 0;
+    
+    for (std::size_t i = 0; i < numActive; ++i)
+        if (! skipIfIdle (i, chunkChannels[i], chunk))
+            running[numRunning++] = i;
+    
+    if (numRunning == numActive)
+        processChunk (chunkChannels, numActive, chunk, useReference);
+    else if (numRunning == 1)
+        processChunk (chunkChannels + running[0], 1, chunk, useReference, running[0]);
+    
+    for (std::size_t i = 0; i < numRunning; ++i)
+        updateIdle (running[i], chunkChannels[running[i]], chunk);
+    
+    if (shareLeftChain)
+    {
+        std::copy (chunkChannels[0], chunkChannels[0] + chunk, chunkChannels[1]);
+        rightChainIdle = true;
+    }
+    else if (numChains == 2)
+    {
+        // same input, same output means the two chains have the same history from here on
+        // (and two idle chains have both been cleared)
+        chainsMatch = numRunning == 0
+                   || (identicalInputs && numRunning == 2 && samplesMatch (chunkChannels[0], chunkChannels[1], chunk));
+    }
+}
+
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processChunk (SampleType* const* channels, std::size_t numChannels, int numSamples,
+                                            bool useReference, std::size_t firstChannel)
+{
+    // the circuit engine only comes one way
+    if (circuitModel)
+    {
+        processCircuit (channels, numChannels, numSamples, firstChannel);
+    }
+    else if (useReference)
+    {
+        for (std::size_t i = 0; i < numChannels; ++i)
+            processChannel (firstChannel + i, juce::dsp::AudioBlock<SampleType> (channels + i, 1, (size_t) numSamples));
+    }
+    else
+    {
+        processFused (channels, numChannels, numSamples, firstChannel);
+    }
+}
+
+// Bit for bit, so -0 vs +0 or two different NaNs count as different and get processed separately
+template <typename SampleType>
+bool FuzzColaDsp<SampleType>::samplesMatch (const SampleType* a, const SampleType* b, int numSamples) noexcept
+{
+    return std::memcmp (a, b, sizeof (SampleType) * (size_t) numSamples) == 0;
+}
+
+// Everything with memory in the right channel's path, copied in place (same sizes, no allocation)
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::copyLeftChainToRight()
+{
+    chains[1] = chains[0];
+    circuits[1] = circuits[0];
+    postSystems[1] = postSystems[0];
+    cabinet->copyChannelState (0, 1);
+    
+    if (outgoingCabinet != nullptr)
+        outgoingCabinet->copyChannelState (0, 1);
+    
+    oversampler.copyChannelState (0, 1);
+    activity[1] = activity[0];
+    padding[1] = padding[0];
+    outgoing[1] = outgoing[0];
+    outgoingOversampler.copyChannelState (0, 1);
+}
+
+// Remembers the input for priming, and if delayedOutput is given, writes the input delayed by the
+// pedal's latency into it (can be the input itself)
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::pushHistory (SampleType* const* input, std::size_t numChannels, int numSamples,
+                                           SampleType* const* delayedOutput)
+{
+    jassert (latencySamples <= historyMask);
+    
+    for (std::size_t c = 0; c < numChannels; ++c)
+    {
+        SampleType* history = inputHistory[c].data();
+        int position = historyPosition;
+        
+        for (int i = 0; i < numSamples; ++i)
+        {
+            history[position] = input[c][i];
+            
+            if (delayedOutput != nullptr)
+                delayedOutput[c][i] = history[(position - latencySamples) & historyMask];
+            
+            position = (position + 1) & historyMask;
+        }
+    }
+    
+    historyPosition = (historyPosition + numSamples) & historyMask;
+}
+
+// Runs the chains over up to maxSamples of the history they haven't seen yet (the output gets
+// thrown away) while the dry signal keeps playing. Called with twice the chunk, so it gains a chunk
+// on the input every chunk and never costs more than the pedal on a block twice the size, rather
+// than all of primeSamples landing in one callback. Once it's caught up the filters and clippers are
+// where they'd be if the pedal had been on all along, and the fade in starts
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::primeStep (std::size_t numChains, int maxSamples, bool useReference)
+{
+    const int maxChunk = oversampler.getMaximumBlockSize();
+    int remaining = juce::jmin (maxSamples, (historyPosition - primePosition) & historyMask);
+    
+    while (remaining > 0)
+    {
+        const int length = juce::jmin (remaining, maxChunk);
+        SampleType* chunkChannels[maxChannels] = {};
+        
+        for (std::size_t c = 0; c < numChains; ++c)
+        {
+            for (int i = 0; i < length; ++i)
+                dryBuffers[c][(size_t) i] = inputHistory[c][(size_t) ((primePosition + i) & historyMask)];
+            
+            chunkChannels[c] = dryBuffers[c].data();
+        }
+        
+        processWet (chunkChannels, numChains, length, useReference);
+        primePosition = (primePosition + length) & historyMask;
+        remaining -= length;
+    }
+    
+    if (primePosition == historyPosition)
+    {
+        priming = false;
+        wetMix.setTargetValue (SampleType (1));
+    }
+}
+
+// Counts how long the input has been silent (as the clippers would see it, so after the sustain gain)
+// and zeroes the output instead of processing if the channel has already gone idle
+template <typename SampleType>
+bool FuzzColaDsp<SampleType>::skipIfIdle (std::size_t channel, SampleType* data, int numSamples)
+{
+    auto& state = activity[channel];
+    const SampleType inputGain = juce::dsp::get<InputGainIndex> (chains[channel]).getGainLinear();
+    
+    if (peakLevel (data, numSamples) * inputGain >= silenceThreshold)
+    {
+        state.silentSamples = 0;
+        state.idle = false;
+        return false;
+    }
+    
+    state.silentSamples = juce::jmin (state.silentSamples + numSamples, tailSamples);
+    
+    if (! state.idle)
+        return false;
+    
+    std::fill (data, data + numSamples, SampleType (0));
+    return true;
+}
+
+// Goes idle once the input has been silent for the whole tail and the output agrees.
+// The leftover state is cleared so the channel starts from scratch when its input comes back
+// (which is also what lets two idle chains count as matching for the dual mono check)
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::updateIdle (std::size_t channel, const SampleType* output, int numSamples)
+{
+    auto& state = activity[channel];
+    
+    if (state.silentSamples < tailSamples || peakLevel (output, numSamples) >= silenceThreshold)
+        return;
+    
+    state.idle = true;
+    chains[channel].reset();
+    circuits[channel].reset();
+    oversampler.resetChannel ((int) channel);
+    padding[channel].reset();
+    cabinet->resetChannel ((int) channel);
+    
+    if (outgoingCabinet != nullptr)
+        outgoingCabinet->resetChannel ((int) channel);
+}
+
+template <typename SampleType>
+SampleType FuzzColaDsp<SampleType>::peakLevel (const SampleType* data, int numSamples) noexcept
+{
+    const auto range = juce::FloatVectorOperations::findMinAndMax (data, numSamples);
+    return juce::jmax (-range.getStart(), range.getEnd());
+}
+
+// Ring out time of the slowest pole in the chain (the 30 Hz input HPF, in practice), from the
+// hottest signal the sustain gain can put into it down to silenceThreshold, then the cabinet IR on top
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::updateTailLength()
+{
+    auto& chain = chains[0];
+    auto& toneStack = juce::dsp::get<ToneStackIndex> (chain);
+    
+    const double slowestPole = juce::jmax (StateSpace::poleRadius (StateSpace::fromSvf (juce::dsp::get<PreHighPassIndex> (chain).getCoefficients())),
+                                           StateSpace::poleRadius (StateSpace::fromSvf (toneStack.getLowShelf().getCoefficients())),
+                                           StateSpace::poleRadius (StateSpace::fromSvf (toneStack.getHighShelf().getCoefficients())),
+                                           StateSpace::poleRadius (StateSpace::fromOnePole ((double) juce::dsp::get<PostLowPassIndex> (chain).getCoefficient())));
+    
+    const double range = juce::Decibels::decibelsToGain ((double) maxSustainDb) / (double) silenceThreshold;
+    const double decaySamples = std::log (range) / -std::log (juce::jlimit (1.0e-6, 1.0 - 1.0e-9, slowestPole));
+    
+    filterTailSamples = (int) std::ceil (decaySamples);
+    tailSamples = filterTailSamples + cabinet->getLength();
+}
+
+// Runs one channel through the chain, the clippers are the only stages that get oversampled
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processChannel (std::size_t channel, juce::dsp::AudioBlock<SampleType> block)
+{
+    auto& chain = chains[channel];
+    juce::dsp::ProcessContextReplacing<SampleType> context (block);
+    
+    // linear stuff in front of the clippers at the base rate
+    juce::dsp::get<InputGainIndex> (chain).process (context);
+    juce::dsp::get<PreHighPassIndex> (chain).process (context);
+    
+    // when oversampling is off processUp just hands back the same samples
+    const int numSamples = (int) block.getNumSamples();
+    SampleType* data = block.getChannelPointer (0);
+    SampleType* upChannels[] = { oversampler.processUp ((int) channel, data, numSamples) };
+    
+    juce::dsp::AudioBlock<SampleType> upBlock (upChannels, 1, (size_t) (numSamples * oversampler.getFactor()));
+    juce::dsp::ProcessContextReplacing<SampleType> upContext (upBlock);
+    
+    // the table replaces both clippers at once, ADAA needs the real stages though
+    if (useClipTable && adaaOrder == 0)
+    {
+        clipTable->processBlock (upChannels[0], (int) upBlock.getNumSamples());
+    }
+    else
+    {
+        juce::dsp::get<Clipper1Index> (chain).process (upContext);
+        juce::dsp::get<Clipper2Index> (chain).process (upContext);
+    }
+    
+    oversampler.processDown ((int) channel, data, numSamples);
+    padding[channel].process (data, numSamples, paddingSamples);
+    
+    // tone and filtering after the clippers back at the base rate
+    // (the reference switches the tone stack straight in/out, the fade is only in the fused engine)
+    juce::dsp::ProcessContextReplacing<SampleType> toneContext (block);
+    toneContext.isBypassed = toneMix.getTargetValue() < 0.5f;
+    juce::dsp::get<ToneStackIndex> (chain).process (toneContext);
+    juce::dsp::get<PostLowPassIndex> (chain).process (context);
+    juce::dsp::get<OutputGainIndex> (chain).process (context);
+    
+    // cabinet, in tile sized pieces
+    for (int start = 0; start < numSamples; start += fusedTileSize)
+        processCabinet (channel, data + start, juce::jmin (fusedTileSize, numSamples - start), false);
+}
+
+// Same stages as processChannel, but tile by tile so the data never leaves cache between stages
+// Every configuration (tone in/out, mono/stereo) has its own compiled loop, picked once per block,
+// so a stage that's switched off isn't there at all rather than being skipped per sample
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processFused (SampleType* const* channels, std::size_t numChannels, int numSamples,
+                                            std::size_t firstChannel)
+{
+    const bool toneEnabled = toneMix.getTargetValue() > 0.5f;
+    
+    if (numChannels == 1)
+    {
+        if (toneEnabled)
+            processFusedVariant<true, 1> (channels, numSamples, firstChannel);
+        else
+            processFusedVariant<false, 1> (channels, numSamples, firstChannel);
+    }
+    else
+    {
+        jassert (firstChannel == 0);
+        
+        if (toneEnabled)
+            processFusedVariant<true, 2> (channels, numSamples, 0);
+        else
+            processFusedVariant<false, 2> (channels, numSamples, 0);
+    }
+}
+
+// While nothing is ramping, gain + HPF run as one loop on local copies of the filter (in stereo,
+// both channels at once in SIMD lanes) and everything after the clippers runs as one
+// block state-space system (or just the LPF when the tone stack is out)
+template <typename SampleType>
+template <bool toneEnabled, std::size_t numChannels>
+void FuzzColaDsp<SampleType>::processFusedVariant (SampleType* const* channels, int numSamples, std::size_t firstChannel)
+{
+    auto anyRamping = [this, firstChannel] (auto isRamping)
+    {
+        for (std::size_t i = 0; i < numChannels; ++i)
+            if (isRamping (chains[firstChannel + i]))
+                return true;
+        
+        return false;
+    };
+    
+    for (int start = 0; start < numSamples; start += fusedTileSize)
+    {
+        const int length = juce::jmin (fusedTileSize, numSamples - start);
+        SampleType* tiles[numChannels];
+        
+        for (std::size_t i = 0; i < numChannels; ++i)
+            tiles[i] = channels[i] + start;
+        
+        // ramps and glides only last a few ms, the per sample loops handle those
+        const bool preRamping = anyRamping ([] (Chain& c) { return juce::dsp::get<InputGainIndex> (c).isSmoothing(); });
+        const bool postRamping = anyRamping ([] (Chain& c) { return (toneEnabled && juce::dsp::get<ToneStackIndex> (c).isGliding())
+                                                                     || juce::dsp::get<OutputGainIndex> (c).isSmoothing(); });
+        
+       #if JUCE_USE_SIMD
+        if (numChannels > 1 && ! preRamping)
+            processPreClipperLanes (tiles, numChannels, length);
+        else
+       #endif
+            for (std::size_t i = 0; i < numChannels; ++i)
+                processPreClipper (firstChannel + i, tiles[i], length, preRamping);
+        
+        // mid quality tier change, same blend for every channel
+        const bool qualityFading = qualityMix.isSmoothing();
+        
+        if (qualityFading)
+            for (int i = 0; i < length; ++i)
+                qualityMixRamp[(std::size_t) i] = qualityMix.getNextValue();
+        
+        for (std::size_t i = 0; i < numChannels; ++i)
+            processClippers (firstChannel + i, tiles[i], length, qualityFading);
+        
+        // mid tone switch both sides run and get blended, same blend for every channel
+        if (toneMix.isSmoothing())
+        {
+            for (int i = 0; i < length; ++i)
+                toneMixRamp[(std::size_t) i] = toneMix.getNextValue();
+            
+            for (std::size_t i = 0; i < numChannels; ++i)
+                processPostClipperCrossfade (firstChannel + i, tiles[i], length);
+        }
+        else
+        {
+            for (std::size_t i = 0; i < numChannels; ++i)
+                processPostClipper<toneEnabled> (firstChannel + i, tiles[i], length, postRamping);
+        }
+        
+        // cabinet last, mid IR change the same blend for every channel
+        const bool cabinetFading = cabinetMix.isSmoothing();
+        
+        if (cabinetFading)
+            for (int i = 0; i < length; ++i)
+                cabinetMixRamp[(std::size_t) i] = cabinetMix.getNextValue();
+        
+        for (std::size_t i = 0; i < numChannels; ++i)
+            processCabinet (firstChannel + i, tiles[i], length, cabinetFading);
+    }
+}
+
+// sustain gain + input HPF
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processPreClipper (std::size_t channel, SampleType* tile, int length, bool ramping)
+{
+    auto& inputGain = juce::dsp::get<InputGainIndex> (chains[channel]);
+    auto& preFilter = juce::dsp::get<PreHighPassIndex> (chains[channel]);
+    
+    if (ramping)
+    {
+        fillGainRamp (inputGain, length);
+        DspKernels::applyGains (tile, gainRamp.data(), length);
+        preFilter.processSamples (tile, length);
+        return;
+    }
+    
+    const SampleType gain = inputGain.getGainLinear();
+    auto hpf = preFilter;
+    
+    for (int i = 0; i < length; ++i)
+        tile[i] = hpf.processSample (gain * tile[i]);
+    
+    preFilter = hpf;
+}
+
+// clippers, oversampled, over the tile (the fast tanh is vectorised across it)
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processClippers (std::size_t channel, SampleType* tile, int length, bool qualityFading)
+{
+    auto& chain = chains[channel];
+    
+    if (qualityFading)
+    {
+        std::copy (tile, tile + length, outgoingTile.data());
+        processOutgoingClippers (channel, length);
+    }
+    
+    SampleType* up = oversampler.processUp ((int) channel, tile, length);
+    const int upLength = length * oversampler.getFactor();
+    
+    if (useClipTable && adaaOrder == 0)
+    {
+        clipTable->processBlock (up, upLength);
+    }
+    else
+    {
+        juce::dsp::get<Clipper1Index> (chain).processSamples (up, upLength);
+        juce::dsp::get<Clipper2Index> (chain).processSamples (up, upLength);
+    }
+    
+    oversampler.processDown ((int) channel, tile, length);
+    padding[channel].process (tile, length, paddingSamples);
+    
+    if (qualityFading)
+        DspKernels::crossfade (tile, outgoingTile.data(), qualityMixRamp.data(), length);
+}
+
+// juce::dsp::Gain only hands its ramp out a sample at a time through processSample,
+// so it gets collected a tile at a time (1 * gain is exact) for the gain kernel
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::fillGainRamp (juce::dsp::Gain<SampleType>& gain, int length)
+{
+    for (int i = 0; i < length; ++i)
+        gainRamp[(std::size_t) i] = gain.processSample (SampleType (1));
+}
+
+// the gain kernel while it ramps, otherwise one multiply across the tile
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::applyGain (juce::dsp::Gain<SampleType>& gain, SampleType* tile, int length)
+{
+    if (gain.isSmoothing())
+    {
+        fillGainRamp (gain, length);
+        DspKernels::applyGains (tile, gainRamp.data(), length);
+        return;
+    }
+    
+    juce::FloatVectorOperations::multiply (tile, gain.getGainLinear(), length);
+}
+
+// The circuit engine, a tile at a time like the fused path: sustain and the coupling cap, the
+// clippers oversampled, then tone stack, output LPF, volume and the cabinet
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processCircuit (SampleType* const* channels, std::size_t numChannels, int numSamples,
+                                              std::size_t firstChannel)
+{
+    const bool toneEnabled = toneMix.getTargetValue() > SampleType (0.5);
+    
+    for (int start = 0; start < numSamples; start += fusedTileSize)
+    {
+        const int length = juce::jmin (fusedTileSize, numSamples - start);
+        
+        // the fades are the same blend for every channel
+        const bool qualityFading = qualityMix.isSmoothing();
+        const bool toneFading = toneMix.isSmoothing();
+        const bool cabinetFading = cabinetMix.isSmoothing();
+        
+        for (int i = 0; i < length; ++i)
+        {
+            if (qualityFading)
+                qualityMixRamp[(std::size_t) i] = qualityMix.getNextValue();
+            
+            if (toneFading)
+                toneMixRamp[(std::size_t) i] = toneMix.getNextValue();
+            
+            if (cabinetFading)
+                cabinetMixRamp[(std::size_t) i] = cabinetMix.getNextValue();
+        }
+        
+        for (std::size_t i = 0; i < numChannels; ++i)
+        {
+            const std::size_t channel = firstChannel + i;
+            SampleType* tile = channels[i] + start;
+            auto& circuit = circuits[channel];
+            
+            applyGain (juce::dsp::get<InputGainIndex> (chains[channel]), tile, length);
+            circuit.processInput (tile, length);
+            processCircuitClippers (channel, tile, length, qualityFading);
+            circuit.processOutput (tile, length, toneEnabled, toneFading ? toneMixRamp.data() : nullptr);
+            applyGain (juce::dsp::get<OutputGainIndex> (chains[channel]), tile, length);
+            processCabinet (channel, tile, length, cabinetFading);
+        }
+    }
+}
+
+// the circuit's clippers, same steps as processClippers
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processCircuitClippers (std::size_t channel, SampleType* tile, int length, bool qualityFading)
+{
+    auto& circuit = circuits[channel];
+    
+    if (qualityFading)
+    {
+        std::copy (tile, tile + length, outgoingTile.data());
+        processOutgoingClippers (channel, length);
+    }
+    
+    circuit.setOversamplingFactor (oversampler.getFactor());
+    
+    SampleType* up = oversampler.processUp ((int) channel, tile, length);
+    circuit.getClippers().processSamples (up, length * oversampler.getFactor());
+    
+    oversampler.processDown ((int) channel, tile, length);
+    padding[channel].process (tile, length, paddingSamples);
+    
+    if (qualityFading)
+        DspKernels::crossfade (tile, outgoingTile.data(), qualityMixRamp.data(), length);
+}
+
+// tone shelves (when they're in) + post LPF + volume
+template <typename SampleType>
+template <bool toneEnabled>
+void FuzzColaDsp<SampleType>::processPostClipper (std::size_t channel, SampleType* tile, int length, bool ramping)
+{
+    auto& postLowPass = juce::dsp::get<PostLowPassIndex> (chains[channel]);
+    auto& outputGain = juce::dsp::get<OutputGainIndex> (chains[channel]);
+    
+    if constexpr (! toneEnabled)
+    {
+        if (ramping)
+        {
+            postLowPass.processSamples (tile, length);
+            fillGainRamp (outputGain, length);
+            DspKernels::applyGains (tile, gainRamp.data(), length);
+            return;
+        }
+        
+        const SampleType gain = outputGain.getGainLinear();
+        auto lpf = postLowPass;
+        
+        for (int i = 0; i < length; ++i)
+            tile[i] = gain * lpf.processSample (tile[i]);
+        
+        postLowPass = lpf;
+    }
+    else
+    {
+        auto& toneStack = juce::dsp::get<ToneStackIndex> (chains[channel]);
+        
+        if (ramping)
+        {
+            for (int i = 0; i < length; ++i)
+                tile[i] = toneStack.processSample (tile[i]);
+            
+            postLowPass.processSamples (tile, length);
+            fillGainRamp (outputGain, length);
+            DspKernels::applyGains (tile, gainRamp.data(), length);
+            return;
+        }
+        
+        auto& lowShelf = toneStack.getLowShelf();
+        auto& highShelf = toneStack.getHighShelf();
+        auto& post = postSystems[channel];
+        
+        // only rebuilt when TONE has moved (or the sample rate changed), not per block
+        if (post.lowShelf != lowShelf.getCoefficients() || post.highShelf != highShelf.getCoefficients()
+            || post.lowPass != postLowPass.getCoefficient())
+        {
+            post.lowShelf = lowShelf.getCoefficients();
+            post.highShelf = highShelf.getCoefficients();
+            post.lowPass = postLowPass.getCoefficient();
+        
+            post.system.setSystem (StateSpace::series (StateSpace::series (StateSpace::fromSvf (post.lowShelf),
+                                                                           StateSpace::fromSvf (post.highShelf)),
+                                                       StateSpace::fromOnePole (post.lowPass)));
+        }
+        
+        // the system's state is just the filters' own state, so they carry on from here when the knob moves
+        const auto lowState = lowShelf.getState();
+        const auto highState = highShelf.getState();
+        typename PostClipperSystem::State state { lowState.ic1eq, lowState.ic2eq, highState.ic1eq, highState.ic2eq, postLowPass.getState() };
+        
+        post.system.process (tile, length, state, outputGain.getGainLinear());
+        
+        lowShelf.setState ({ state[0], state[1] });
+        highShelf.setState ({ state[2], state[3] });
+        postLowPass.setState (state[4]);
+    }
+}
+
+// Cabinet IR over the tile (as float), crossfading from the outgoing one while cabinetFading.
+// It comes after the volume rather than straight after the post LPF, both are linear so that's
+// the same thing, and this way the fused and reference paths both run it on their own
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processCabinet (std::size_t channel, SampleType* tile, int length, bool cabinetFading)
+{
+    if (! cabinetFading && ! cabinet->isActive())
+        return;
+    
+    float* wet = cabinetTile.data();
+    std::copy (tile, tile + length, wet);
+    
+    if (cabinetFading)
+    {
+        float* old = outgoingCabinetTile.data();
+        std::copy (wet, wet + length, old);
+        
+        outgoingCabinet->process ((int) channel, old, length);
+        cabinet->process ((int) channel, wet, length);
+        DspKernels::crossfade (wet, old, cabinetMixRamp.data(), length);
+    }
+    else
+    {
+        cabinet->process ((int) channel, wet, length);
+    }
+    
+    std::copy (wet, wet + length, tile);
+}
+
+// the tone switch fade, shelves in and out blended by toneMixRamp
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processPostClipperCrossfade (std::size_t channel, SampleType* tile, int length)
+{
+    auto& toneStack = juce::dsp::get<ToneStackIndex> (chains[channel]);
+    auto& postLowPass = juce::dsp::get<PostLowPassIndex> (chains[channel]);
+    auto& outputGain = juce::dsp::get<OutputGainIndex> (chains[channel]);
+    
+    for (int i = 0; i < length; ++i)
+    {
+        const SampleType dry = tile[i];
+        const SampleType wet = toneStack.processSample (dry);
+        const SampleType mixed = dry + toneMixRamp[(std::size_t) i] * (wet - dry);
+        
+        tile[i] = outputGain.processSample (postLowPass.processSample (mixed));
+    }
+}
+
+#if JUCE_USE_SIMD
+// The pre-clipper loop with each of the (at most two) channels in its own lane, only used while
+// nothing is ramping. FuzzColaBench's stage/preclipper cases time it against the per-channel loop
+template <typename SampleType>
+void FuzzColaDsp<SampleType>::processPreClipperLanes (SampleType* const* tiles, std::size_t numChannels, int length)
+{
+    SampleType gains[2] = {};
+    TptSvf<SampleType>* preFilters[2] = {};
+    
+    for (std::size_t i = 0; i < numChannels; ++i)
+    {
+        gains[i] = juce::dsp::get<InputGainIndex> (chains[i]).getGainLinear();
+        preFilters[i] = &juce::dsp::get<PreHighPassIndex> (chains[i]);
+    }
+    
+    const auto gain = LaneFilters::packValues (gains, numChannels);
+    auto hpf = LaneFilters::pack (preFilters, numChannels);
+    
+    constexpr std::size_t width = Lanes::size();
+    LaneFilters::interleave (tiles, numChannels, length, laneBuffer.data());
+    
+    for (int i = 0; i < length; ++i)
+    {
+        SampleType* frame = laneBuffer.data() + (std::size_t) i * width;
+        hpf.processSample (gain * Lanes::fromRawArray (frame)).copyToRawArray (frame);
+    }
+    
+    LaneFilters::deinterleave (laneBuffer.data(), tiles, numChannels, length);
+    LaneFilters::unpack (hpf, preFilters, numChannels);
+}
+#endif
+
+template class FuzzColaDsp<float>;
+template class FuzzColaDsp<double>;
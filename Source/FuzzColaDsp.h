@@ -0,0 +1,315 @@
+/*
+ ==============================================================================
+
+ FuzzColaDsp.h
+ The whole pedal as one DSP engine, templated on the sample type.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include "HalfBandOversampler.h"
+#include "ClipperShapers.h"
+#include "CompositeClipTable.h"
+#include "ToneStack.h"
+#include "LaneFilters.h"
+#include "StateSpaceFilter.h"
+#include "DspKernels.h"
+#include "PartitionedConvolver.h"
+#include "FuzzCircuit.h"
+
+// Everything the DSP needs from the plugin's parameters, as plain values
+struct FuzzColaParameters
+{
+    float sustain = 0.5f;              // 0 .. 1
+    float tone = 0.5f;                 // 0 .. 1, dark .. bright
+    float volumeDb = 0.0f;
+    bool toneEnabled = true;
+    int oversamplingStages = 0;        // 0 = off, 1 = 2x, 2 = 4x, 3 = 8x
+    bool linearPhaseOversampling = false;
+    int adaaOrder = 0;                 // 0 = off, 1 = 1st order, 2 = 2nd order
+    bool useClipTable = false;
+    bool exactClippers = false;        // std::tanh instead of the fast approximation (when ADAA is off)
+    bool pedalOn = true;               // footswitch, off = the dry input (delayed to match the latency)
+    int qualityTier = 0;               // adaptive quality, 0 = the settings above, each step cheaper (see applyQualityTier)
+    bool circuitModel = false;         // the wave digital circuit (FuzzCircuit.h) instead of the tanh stages and shelves
+};
+
+// The pedal's signal path, no AudioProcessor or APVTS in here
+// The plugin keeps a float and a double one and runs whichever the host asks for,
+// so 64 bit hosts don't pay for a conversion each way, and the low corner filters at high
+// sample rates get the extra precision
+// Stereo at most, mono input runs only the first chain
+template <typename SampleType>
+class FuzzColaDsp
+{
+    public:
+    static constexpr int maxChannels = 2;
+
+    ~FuzzColaDsp();
+
+    // call off the audio thread, this is where everything gets allocated
+    void prepare (double sampleRate, int maximumBlockSize);
+    void reset();
+
+    // change driven, only what actually moved gets pushed into the stages (call once per block)
+    void setParameters (const FuzzColaParameters& newParameters);
+
+    // oversampler + ADAA delay at the current settings, rounded to whole samples
+    int getLatencyInSamples() const noexcept { return latencySamples; }
+    
+    // how long the filters keep ringing once the input stops (worked out from their poles in prepare),
+    // plus the cabinet IR
+    double getTailLengthSeconds() const noexcept { return (filterTailSamples + cabinetLength.load (std::memory_order_relaxed)) / sampleRate; }
+    
+    // anything quieter than this (about -100 dB) counts as silence
+    static constexpr SampleType silenceThreshold = SampleType (1.0e-5);
+
+    // in place, numChannels is 1 or 2, any block size (bigger than the prepared one gets split)
+    // Identical L/R is spotted and only costs one chain, bypassed it's only a short delay line
+    void process (SampleType* const* channels, int numChannels, int numSamples);
+
+    // Stage by stage through the ProcessorChain instead of the fused loops (same result, slower)
+    // handy for checking the fused path against the original
+    void setUseReferenceChain (bool shouldUseReference) noexcept { useReferenceChain = shouldUseReference; }
+    
+    // Adaptive quality: every tier takes the anti-aliasing down one notch from the settings,
+    // 8x -> 4x -> 2x -> ADAA -> plain fast tanh -> lookup table, until there's nothing left to drop
+    // (the circuit engine only has the oversampling to give up).
+    // The latency stays at what tier 0 needs (cheaper tiers get padded up to it) so the host never
+    // sees it move, and a tier change crossfades from the old setup to the new one
+    static FuzzColaParameters applyQualityTier (FuzzColaParameters parameters, int tier) noexcept;
+    static int getNumQualityTiers (const FuzzColaParameters& parameters) noexcept;   // counting tier 0
+    
+    // Cabinet IR stage, after everything else. Call from any thread but the audio one: the convolver
+    // for ir gets built here and the audio thread fades over to it at the start of its next block,
+    // or a reset takes it straight in (nullptr takes the stage out). Whatever the audio thread is done with waits for
+    // releaseRetiredCabinet, which the loader calls as it polls, so nothing is freed on the audio thread
+    void setImpulseResponse (std::shared_ptr<const ImpulseResponse> ir);
+    void releaseRetiredCabinet();
+
+    private:
+    // its always much easier to keep track of chain if enum
+    enum ChainPositions
+    {
+        InputGainIndex = 0,  // pre-gain / Sustain
+        PreHighPassIndex = 1,  // input HPF
+        Clipper1Index = 2,  // clipping stage 1
+        Clipper2Index = 3,  // clipping stage 2
+        ToneStackIndex = 4,  // HP/LP blend tone stack
+        PostLowPassIndex = 5,  // final fizz killer, when listening to original pedal i realized it needs a way to get rid of extra fizz
+        OutputGainIndex = 6   // Volume
+    };
+
+    // one mono chain, the clippers are templated on their curve so they inline and vectorise
+    using Chain = juce::dsp::ProcessorChain<
+    juce::dsp::Gain<SampleType>,                      // InputGainIndex
+    TptSvf<SampleType>,                               // PreHighPassIndex
+    ShaperStage<SymmetricClipCurve, SampleType>,      // Clipper1Index
+    ShaperStage<OffsetClipCurve, SampleType>,         // Clipper2Index
+    ToneStack<SampleType>,                            // ToneStackIndex
+    TptOnePole<SampleType>,                           // PostLowPassIndex
+    juce::dsp::Gain<SampleType>                       // OutputGainIndex
+    >;
+
+    // 2 mono chains (L/R)
+    std::array<Chain, maxChannels> chains;
+
+    double sampleRate = 44100.0;
+
+    // The circuit engine, one per channel, it uses the chains' input and output gains for
+    // SUSTAIN and VOLUME. Only one engine runs at a time (see setParameters for the switch)
+    std::array<FuzzCircuit<SampleType>, maxChannels> circuits;
+    bool circuitModel = false;
+    
+    void processCircuit (SampleType* const* channels, std::size_t numChannels, int numSamples, std::size_t firstChannel);
+    void processCircuitClippers (std::size_t channel, SampleType* tile, int length, bool qualityFading);
+
+    // Oversampling around the two clippers only, linear stages stay at the base rate
+    HalfBandOversampler<SampleType> oversampler;
+    int latencySamples = 0;
+
+    // ADAA on the clippers (0 = off, 1 = 1st order, 2 = 2nd order) and the mode that ended up in
+    int adaaOrder = -1;
+    ShaperMode shaperMode = ShaperMode::fast;
+
+    // clip2(clip1(x)) as one table, shared by every instance
+    std::shared_ptr<const CompositeClipTable> clipTable;
+    bool useClipTable = false;
+
+    void updateAntiAliasing (const FuzzColaParameters& parameters);
+    static bool stepQualityDown (FuzzColaParameters& parameters) noexcept;
+    double getPathLatency (const FuzzColaParameters& settings) const;
+    void processWet (SampleType* const* chunkChannels, std::size_t numChains, int chunk, bool useReference);
+    void processChunk (SampleType* const* channels, std::size_t numChannels, int numSamples,
+                       bool useReference, std::size_t firstChannel = 0);
+    void processChannel (std::size_t channel, juce::dsp::AudioBlock<SampleType> block);
+    
+    // Dual mono (a mono track duplicated onto both sides): while L and R are bit identical only
+    // the left chain runs. The right chain is left alone until the sides split, then it gets the
+    // left chain's state, so it carries on exactly as if it had been running the whole time
+    bool chainsMatch = true;       // both chains hold the same state (last stereo chunk went in and came out identical)
+    bool rightChainIdle = false;   // the left chain has been standing in for the right one
+    
+    static bool samplesMatch (const SampleType* a, const SampleType* b, int numSamples) noexcept;
+    void copyLeftChainToRight();
+    
+    // Silence detection, per channel: once the input has been silent for tailSamples and the
+    // output has died away too, the channel stops processing until the input comes back
+    struct ChannelActivity
+    {
+        int silentSamples = 0;
+        bool idle = false;
+    };
+    
+    std::array<ChannelActivity, maxChannels> activity {};
+    int filterTailSamples = 0;
+    int tailSamples = 0;           // filters + cabinet
+    
+    bool skipIfIdle (std::size_t channel, SampleType* data, int numSamples);
+    void updateIdle (std::size_t channel, const SampleType* output, int numSamples);
+    void updateTailLength();
+    static SampleType peakLevel (const SampleType* data, int numSamples) noexcept;
+
+    // Fused path: every stage runs over one small tile before the next tile starts,
+    // 64 samples (512 once 8x oversampled) stays well inside L1
+    static constexpr int fusedTileSize = 64;
+    std::atomic<bool> useReferenceChain { false };
+
+    void processFused (SampleType* const* channels, std::size_t numChannels, int numSamples, std::size_t firstChannel);
+    void processPreClipper (std::size_t channel, SampleType* tile, int length, bool ramping);
+    void processClippers (std::size_t channel, SampleType* tile, int length, bool qualityFading);
+    void processPostClipperCrossfade (std::size_t channel, SampleType* tile, int length);
+
+    template <bool toneEnabled, std::size_t numChannels>
+    void processFusedVariant (SampleType* const* channels, int numSamples, std::size_t firstChannel);
+
+    template <bool toneEnabled>
+    void processPostClipper (std::size_t channel, SampleType* tile, int length, bool ramping);
+
+    // a ramping gain's values over the current tile
+    std::array<SampleType, fusedTileSize> gainRamp {};
+    void fillGainRamp (juce::dsp::Gain<SampleType>& gain, int length);
+    void applyGain (juce::dsp::Gain<SampleType>& gain, SampleType* tile, int length);
+    
+    // TONEBYPASS (tone enabled) as a 0..1 blend, so switching the tone stack in and out fades
+    juce::SmoothedValue<SampleType> toneMix { SampleType (1) };
+    std::array<SampleType, fusedTileSize> toneMixRamp {};
+
+   #if JUCE_USE_SIMD
+    // both channels side by side in one SIMD register for gain + HPF
+    using Lanes = LaneFilters::Lanes<SampleType>;
+    alignas (Lanes) std::array<SampleType, fusedTileSize * Lanes::size()> laneBuffer {};
+
+    void processPreClipperLanes (SampleType* const* tiles, std::size_t numChannels, int length);
+   #endif
+
+    // tone shelves + post LPF as one 5th order state-space system, per channel,
+    // along with the coefficients it was built from
+    struct PostClipperSystem
+    {
+        using State = typename BlockStateSpace<SampleType, 5>::State;
+
+        BlockStateSpace<SampleType, 5> system;
+        SvfCoefficients<SampleType> lowShelf, highShelf;
+        SampleType lowPass = SampleType (-1);
+    };
+
+    std::array<PostClipperSystem, maxChannels> postSystems;
+
+    // Quality tiers below 0 are delayed after the clippers by whatever latency they save,
+    // so every tier lines up with tier 0 (one short ring per channel)
+    struct PaddingDelay
+    {
+        std::vector<SampleType> buffer;
+        int mask = 0;
+        int position = 0;
+        
+        void prepare (int maximumDelay);
+        void reset() noexcept;
+        void process (SampleType* data, int numSamples, int delay) noexcept;
+    };
+    
+    std::array<PaddingDelay, maxChannels> padding;
+    int paddingSamples = 0;
+    
+    // Tier changes: the outgoing setup (its oversampler, clipper stages and padding, copied over
+    // when the tier moves) keeps running on a copy of each tile until the new one has faded in.
+    // Both sides have the same latency, so it's a plain linear crossfade
+    struct OutgoingClippers
+    {
+        ShaperStage<SymmetricClipCurve, SampleType> clipper1;
+        ShaperStage<OffsetClipCurve, SampleType> clipper2;
+        typename FuzzCircuit<SampleType>::Clippers circuitClippers;
+        PaddingDelay padding;
+    };
+    
+    static constexpr double qualityFadeSeconds = 0.02;
+    std::array<OutgoingClippers, maxChannels> outgoing;
+    HalfBandOversampler<SampleType> outgoingOversampler;
+    bool outgoingUsesTable = false;
+    int outgoingPaddingSamples = 0;
+    int qualityTier = 0;
+    juce::SmoothedValue<SampleType> qualityMix { SampleType (1) };
+    std::array<SampleType, fusedTileSize> qualityMixRamp {};
+    std::array<SampleType, fusedTileSize> outgoingTile {};
+    
+    void beginQualityFade();
+    void processOutgoingClippers (std::size_t channel, int length);
+    
+    // Cabinet: the running convolver (never null, an empty one is a straight wire), and while it fades
+    // in, the one it took over from. New ones come in through pendingCabinet and old ones go back out
+    // through retiredCabinet, one at a time each way
+    std::unique_ptr<PartitionedConvolver> cabinet = std::make_unique<PartitionedConvolver>();
+    std::unique_ptr<PartitionedConvolver> outgoingCabinet;
+    std::atomic<PartitionedConvolver*> pendingCabinet { nullptr };
+    std::atomic<PartitionedConvolver*> retiredCabinet { nullptr };
+    std::atomic<int> cabinetLength { 0 };
+    
+    // it's all float (juce's FFT only does float, and a cab IR doesn't need more), so the double engine converts
+    static constexpr double cabinetFadeSeconds = 0.05;
+    juce::SmoothedValue<float> cabinetMix { 1.0f };
+    std::array<float, fusedTileSize> cabinetMixRamp {};
+    std::array<float, fusedTileSize> cabinetTile {};
+    std::array<float, fusedTileSize> outgoingCabinetTile {};
+    
+    void updateCabinet (bool skipFade);
+    void processCabinet (std::size_t channel, SampleType* tile, int length, bool cabinetFading);
+    
+    // Footswitch (PEDALON) as a 0..1 blend between the dry input and the pedal, equal power
+    static constexpr double bypassFadeSeconds = 0.01;
+    juce::SmoothedValue<SampleType> wetMix { SampleType (1) };
+    bool lastPedalOn = true;
+    
+    // Recent input per channel (power of two ring): the dry side of the bypass is read back
+    // from it latencySamples late, and the chains get primed from it when the pedal comes back on
+    static constexpr double primeSeconds = 0.04;   // a few time constants of the 30 Hz HPF
+    std::array<std::vector<SampleType>, maxChannels> inputHistory;
+    int historyMask = 0;
+    int historyPosition = 0;
+    int primeSamples = 0;
+    
+    // Priming: pending until the next process call clears the chains, then they run through the
+    // history from primePosition a bit faster than it fills until they've caught up (see primeStep)
+    bool primePending = false;
+    bool priming = false;
+    int primePosition = 0;
+    
+    // scratch for the dry side while fading, and what priming runs through
+    std::array<std::vector<SampleType>, maxChannels> dryBuffers;
+    
+    void pushHistory (SampleType* const* input, std::size_t numChannels, int numSamples, SampleType* const* delayedOutput);
+    void primeStep (std::size_t numChains, int maxSamples, bool useReference);
+    
+    // SUSTAIN 0..1 maps onto this much pre-gain (in dB)
+    static constexpr float minSustainDb = 15.0f;
+    static constexpr float maxSustainDb = 45.0f;
+    
+    // What the DSP was last set to, only parameters that changed get pushed again
+    float lastSustain = 0.0f;
+    float lastVolumeDb = 0.0f;
+    float lastTone = 0.0f;
+    bool lastToneEnabled = true;
+    bool forceParameterUpdate = true;
+};
@@ -0,0 +1,237 @@
+/*
+ ==============================================================================
+
+ FuzzColaEngine.cpp
+ Picks the precision, applies the render profile and adaptive quality, runs the DSP.
+
+ ==============================================================================
+ */
+
+#include "FuzzColaEngine.h"
+
+FuzzColaEngine::FuzzColaEngine()
+{
+    // picks the SIMD kernels for this CPU now rather than on the first audio block
+    DspKernels::get();
+}
+
+FuzzColaEngine::~FuzzColaEngine()
+{
+}
+
+void FuzzColaEngine::prepare (double newSampleRate, int newMaximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    maximumBlockSize = newMaximumBlockSize;
+
+    // both precisions get prepared, callers can switch between them without calling this again
+    floatDsp.prepare (sampleRate, maximumBlockSize);
+    doubleDsp.prepare (sampleRate, maximumBlockSize);
+
+    // float callers get converted to double for the render profile
+    renderBuffer.setSize (maxChannels, maximumBlockSize);
+
+    const FuzzColaParameters running = getRunningParameters();
+    floatDsp.setParameters (running);
+    doubleDsp.setParameters (running);
+    latencySamples.store (doubleDsp.getLatencyInSamples(), std::memory_order_relaxed);
+}
+
+void FuzzColaEngine::reset()
+{
+    floatDsp.reset();
+    doubleDsp.reset();
+}
+
+double FuzzColaEngine::getTailLengthSeconds() const noexcept
+{
+    return floatDsp.getTailLengthSeconds() + juce::jmax (0, latencySamples.load (std::memory_order_relaxed)) / sampleRate;
+}
+
+void FuzzColaEngine::setImpulseResponse (std::shared_ptr<const ImpulseResponse> ir)
+{
+    floatDsp.setImpulseResponse (ir);
+    doubleDsp.setImpulseResponse (ir);
+}
+
+void FuzzColaEngine::releaseRetiredCabinet()
+{
+    floatDsp.releaseRetiredCabinet();
+    doubleDsp.releaseRetiredCabinet();
+}
+
+bool FuzzColaEngine::loadImpulseResponse (const juce::File& file)
+{
+    jassert (maximumBlockSize > 0);   // the IR gets resampled to the prepared rate
+
+    auto ir = file.existsAsFile() ? ImpulseResponse::getShared (file, sampleRate) : nullptr;
+
+    if (ir == nullptr)
+        return false;
+
+    setImpulseResponse (std::move (ir));
+    return true;
+}
+
+// The parameters as they should run right now
+FuzzColaParameters FuzzColaEngine::getRunningParameters() const noexcept
+{
+    FuzzColaParameters running = parameters;
+
+    // Render profile: at least the render oversampling, exact curves rather than the fast tanh
+    // or the table (ADAA and the filter choice stay as they are, they only add quality)
+    if (isRenderProfileActive())
+    {
+        running.oversamplingStages = juce::jmax (running.oversamplingStages, options.offlineOversamplingStages);
+        running.exactClippers = true;
+        running.useClipTable = false;
+    }
+
+    // adaptive quality only ever kicks in live, offline there's no deadline to miss
+    if (options.adaptiveQuality && ! options.offline)
+        running.qualityTier = qualityTier.load (std::memory_order_relaxed);
+
+    return running;
+}
+
+// Nothing's allocated before prepare(), and the render profile would chop the block into
+// chunks of zero samples forever. The C API lets callers get here, so it can't just be an assert
+template <typename SampleType>
+bool FuzzColaEngine::clearIfUnprepared (SampleType* const* channels, int numOutputChannels, int numSamples) const
+{
+    if (maximumBlockSize > 0)
+        return false;
+
+    for (int c = 0; c < numOutputChannels; ++c)
+        juce::FloatVectorOperations::clear (channels[c], numSamples);
+
+    return true;
+}
+
+void FuzzColaEngine::process (float* const* channels, int numInputChannels, int numOutputChannels, int numSamples)
+{
+    if (clearIfUnprepared (channels, numOutputChannels, numSamples))
+        return;
+
+    juce::ScopedNoDenormals noDenormals;
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    // rendering offline the whole pedal runs in double, even for a float caller
+    if (isRenderProfileActive())
+    {
+        const int numBufferChannels = juce::jmin (numOutputChannels, maxChannels);
+        double* renderChannels[maxChannels] = {};
+
+        for (int c = 0; c < numBufferChannels; ++c)
+            renderChannels[c] = renderBuffer.getWritePointer (c);
+
+        for (int start = 0; start < numSamples; start += maximumBlockSize)
+        {
+            const int chunk = juce::jmin (maximumBlockSize, numSamples - start);
+
+            for (int c = 0; c < numBufferChannels; ++c)
+                std::copy (channels[c] + start, channels[c] + start + chunk, renderChannels[c]);
+
+            processWithDsp (renderChannels, juce::jmin (numInputChannels, numBufferChannels), numBufferChannels, chunk, doubleDsp);
+
+            for (int c = 0; c < numBufferChannels; ++c)
+                std::copy (renderChannels[c], renderChannels[c] + chunk, channels[c] + start);
+        }
+
+        for (int c = numBufferChannels; c < numOutputChannels; ++c)
+            juce::FloatVectorOperations::clear (channels[c], numSamples);
+    }
+    else
+    {
+        processWithDsp (channels, numInputChannels, numOutputChannels, numSamples, floatDsp);
+    }
+
+    updateQualityTier (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks), numSamples);
+}
+
+void FuzzColaEngine::process (double* const* channels, int numInputChannels, int numOutputChannels, int numSamples)
+{
+    if (clearIfUnprepared (channels, numOutputChannels, numSamples))
+        return;
+
+    juce::ScopedNoDenormals noDenormals;
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    processWithDsp (channels, numInputChannels, numOutputChannels, numSamples, doubleDsp);
+
+    updateQualityTier (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks), numSamples);
+}
+
+// Same for both precisions, only the DSP differs
+template <typename SampleType>
+void FuzzColaEngine::processWithDsp (SampleType* const* channels, int numInputChannels, int numOutputChannels, int numSamples,
+                                     FuzzColaDsp<SampleType>& dsp)
+{
+    jassert (numInputChannels <= numOutputChannels);
+
+    // Mono in, stereo out: the input runs through one chain and gets fanned out to both sides
+    const bool monoToStereo = numInputChannels == 1 && numOutputChannels == 2;
+
+    for (int channel = monoToStereo ? 2 : numInputChannels; channel < numOutputChannels; ++channel)
+        juce::FloatVectorOperations::clear (channels[channel], numSamples);
+
+    // the footswitch goes in with the rest, the DSP fades to its latency matched dry signal
+    dsp.setParameters (getRunningParameters());
+    latencySamples.store (dsp.getLatencyInSamples(), std::memory_order_relaxed);
+
+    // mono processes the single channel, stereo runs both chains (or one, if L and R are identical)
+    const int numChannels = juce::jmin (numInputChannels, maxChannels);
+
+    if (numChannels == 0 || numSamples <= 0)
+        return;
+
+    dsp.process (channels, numChannels, numSamples);
+
+    if (monoToStereo)
+        std::copy (channels[0], channels[0] + numSamples, channels[1]);
+}
+
+// Adaptive quality: the share of the block's deadline process took, smoothed over a few
+// blocks so one slow one (a page fault, the host doing something) doesn't count. Over budget the
+// tier steps down, and it only steps back up after a couple of seconds well under budget,
+// with a hold after every change so the load can settle at the new tier first
+void FuzzColaEngine::updateQualityTier (double secondsTaken, int numSamples)
+{
+    if (! options.adaptiveQuality || options.offline || numSamples <= 0)
+    {
+        qualityTier.store (0, std::memory_order_relaxed);
+        smoothedLoad = 0.0;
+        tierHoldSeconds = 0.0;
+        headroomSeconds = 0.0;
+        return;
+    }
+
+    const double blockSeconds = numSamples / sampleRate;
+    const double smoothing = 1.0 - std::exp (-blockSeconds / loadSmoothingSeconds);
+    smoothedLoad += smoothing * (secondsTaken / blockSeconds - smoothedLoad);
+
+    const double budget = options.cpuBudgetPercent / 100.0;
+    const int numTiers = FuzzColaDsp<float>::getNumQualityTiers (parameters);
+    int tier = juce::jmin (qualityTier.load (std::memory_order_relaxed), numTiers - 1);
+
+    tierHoldSeconds = juce::jmax (0.0, tierHoldSeconds - blockSeconds);
+    headroomSeconds = smoothedLoad < budget * headroomFraction ? headroomSeconds + blockSeconds : 0.0;
+
+    if (tierHoldSeconds <= 0.0)
+    {
+        const int previousTier = tier;
+
+        if (smoothedLoad > budget && tier < numTiers - 1)
+            ++tier;
+        else if (headroomSeconds >= stepUpSeconds && tier > 0)
+            --tier;
+
+        if (tier != previousTier)
+        {
+            tierHoldSeconds = tierHoldTime;
+            headroomSeconds = 0.0;
+        }
+    }
+
+    qualityTier.store (tier, std::memory_order_relaxed);
+}
@@ -0,0 +1,122 @@
+/*
+ ==============================================================================
+
+ FuzzColaEngine.h
+ The whole pedal as a plain object: prepare, set the parameters, process.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include <atomic>
+#include <memory>
+#include "FuzzColaDsp.h"
+#include "ImpulseResponse.h"
+
+// How the engine runs, as opposed to how it sounds (that's FuzzColaParameters)
+struct FuzzColaEngineOptions
+{
+    bool offline = false;                  // rendering rather than playing live (a host bounce, a batch job)
+    bool highQualityOffline = true;        // offline: all in double, exact clippers, at least offlineOversamplingStages
+    int offlineOversamplingStages = 3;     // 0 = off .. 3 = 8x
+    bool adaptiveQuality = false;          // live only, see updateQualityTier
+    float cpuBudgetPercent = 25.0f;        // of each block's deadline
+};
+
+// What the plugin wraps, and what anything else that wants the pedal without a host uses
+// (FuzzColaEngineC.h has the same as a C API). No AudioProcessor, APVTS or GUI in here:
+// a float and a double FuzzColaDsp, picked per call, with the offline render profile, adaptive
+// quality and the mono to stereo fan out on top.
+// prepare and loadImpulseResponse off the audio thread, the rest from whichever thread processes
+class FuzzColaEngine
+{
+    public:
+    static constexpr int maxChannels = 2;
+
+    FuzzColaEngine();
+    ~FuzzColaEngine();
+
+    void prepare (double sampleRate, int maximumBlockSize);
+    void reset();
+
+    // both go in at the start of the next process call
+    void setParameters (const FuzzColaParameters& newParameters) noexcept { parameters = newParameters; }
+    void setOptions (const FuzzColaEngineOptions& newOptions) noexcept { options = newOptions; }
+
+    const FuzzColaParameters& getParameters() const noexcept { return parameters; }
+    const FuzzColaEngineOptions& getOptions() const noexcept { return options; }
+
+    // In place, any block size. channels holds numOutputChannels pointers: the first
+    // numInputChannels (1 or 2) are processed, mono in / stereo out copies the left side across,
+    // and any other outputs get cleared. Before prepare() it's all silence
+    void process (float* const* channels, int numInputChannels, int numOutputChannels, int numSamples);
+    void process (double* const* channels, int numInputChannels, int numOutputChannels, int numSamples);
+
+    // as of the last process call (or prepare)
+    int getLatencyInSamples() const noexcept { return latencySamples.load (std::memory_order_relaxed); }
+
+    // the filters' and cabinet's ring out plus the latency, how long to keep going once the input stops
+    double getTailLengthSeconds() const noexcept;
+
+    // Adaptive quality tier running right now, 0 = the anti-aliasing as set, every step up is a
+    // notch cheaper (see FuzzColaDsp::applyQualityTier). Fine to poll from any thread
+    int getQualityTier() const noexcept { return qualityTier.load (std::memory_order_relaxed); }
+
+    // Cabinet IR, nullptr takes it out. The switch over fades in at the start of the next process
+    // call, or is there from the first sample if reset() comes in between
+    void setImpulseResponse (std::shared_ptr<const ImpulseResponse> ir);
+    void releaseRetiredCabinet();    // frees what the audio thread has let go of, call now and then
+
+    // reads the file at the prepared rate and sets it, false if it couldn't be read (the cabinet
+    // stays as it was). Slow, keep it off the audio thread
+    bool loadImpulseResponse (const juce::File& file);
+
+    // Stage by stage through the ProcessorChain instead of the fused loops (same result, slower)
+    // handy for checking the fused path against the original
+    void setUseReferenceChain (bool shouldUseReference) noexcept
+    {
+        floatDsp.setUseReferenceChain (shouldUseReference);
+        doubleDsp.setUseReferenceChain (shouldUseReference);
+    }
+
+    private:
+    FuzzColaDsp<float> floatDsp;
+    FuzzColaDsp<double> doubleDsp;
+
+    FuzzColaParameters parameters;
+    FuzzColaEngineOptions options;
+
+    double sampleRate = 44100.0;
+    int maximumBlockSize = 0;
+    std::atomic<int> latencySamples { 0 };     // set by process(), the host reads it for the tail length
+
+    // float callers get converted to double for the render profile
+    juce::AudioBuffer<double> renderBuffer;
+
+    // true if it wasn't prepared yet, in which case the outputs have been cleared
+    template <typename SampleType>
+    bool clearIfUnprepared (SampleType* const* channels, int numOutputChannels, int numSamples) const;
+
+    bool isRenderProfileActive() const noexcept { return options.offline && options.highQualityOffline; }
+    FuzzColaParameters getRunningParameters() const noexcept;
+
+    template <typename SampleType>
+    void processWithDsp (SampleType* const* channels, int numInputChannels, int numOutputChannels, int numSamples,
+                         FuzzColaDsp<SampleType>& dsp);
+
+    // Adaptive quality (see updateQualityTier), all of it audio thread only apart from the tier
+    std::atomic<int> qualityTier { 0 };
+    double smoothedLoad = 0.0;
+    double tierHoldSeconds = 0.0;      // no tier change until this runs out
+    double headroomSeconds = 0.0;      // how long the load has been under budget * headroomFraction
+
+    static constexpr double loadSmoothingSeconds = 0.1;
+    static constexpr double tierHoldTime = 0.5;
+    static constexpr double stepUpSeconds = 2.0;
+    static constexpr double headroomFraction = 0.5;   // each tier roughly halves the cost
+
+    void updateQualityTier (double secondsTaken, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FuzzColaEngine)
+};
@@ -0,0 +1,129 @@
+/*
+ ==============================================================================
+
+ FuzzColaEngineC.cpp
+ The C API, a thin layer over FuzzColaEngine.
+
+ ==============================================================================
+ */
+
+#include "FuzzColaEngineC.h"
+#include "FuzzColaEngine.h"
+
+struct FuzzColaEngineHandle
+{
+    FuzzColaEngine engine;
+};
+
+static FuzzColaParameters toParameters (const FuzzColaEngineParams& params)
+{
+    FuzzColaParameters parameters;
+    parameters.sustain = params.sustain;
+    parameters.tone = params.tone;
+    parameters.volumeDb = params.volumeDb;
+    parameters.toneEnabled = params.toneEnabled != 0;
+    parameters.oversamplingStages = juce::jlimit (0, 3, params.oversamplingStages);
+    parameters.linearPhaseOversampling = params.linearPhaseOversampling != 0;
+    parameters.adaaOrder = juce::jlimit (0, 2, params.adaaOrder);
+    parameters.useClipTable = params.useClipTable != 0;
+    parameters.exactClippers = params.exactClippers != 0;
+    parameters.pedalOn = params.pedalOn != 0;
+    parameters.circuitModel = params.circuitModel != 0;
+    return parameters;
+}
+
+FuzzColaEngineHandle* fuzzColaEngineCreate (void)
+{
+    return new FuzzColaEngineHandle();
+}
+
+void fuzzColaEngineDestroy (FuzzColaEngineHandle* engine)
+{
+    delete engine;
+}
+
+void fuzzColaEnginePrepare (FuzzColaEngineHandle* engine, double sampleRate, int maximumBlockSize)
+{
+    engine->engine.prepare (sampleRate, maximumBlockSize);
+}
+
+void fuzzColaEngineReset (FuzzColaEngineHandle* engine)
+{
+    engine->engine.reset();
+}
+
+void fuzzColaEngineGetDefaultParams (FuzzColaEngineParams* params)
+{
+    const FuzzColaParameters defaults;
+    params->sustain = defaults.sustain;
+    params->tone = defaults.tone;
+    params->volumeDb = defaults.volumeDb;
+    params->toneEnabled = defaults.toneEnabled ? 1 : 0;
+    params->oversamplingStages = defaults.oversamplingStages;
+    params->linearPhaseOversampling = defaults.linearPhaseOversampling ? 1 : 0;
+    params->adaaOrder = defaults.adaaOrder;
+    params->useClipTable = defaults.useClipTable ? 1 : 0;
+    params->exactClippers = defaults.exactClippers ? 1 : 0;
+    params->pedalOn = defaults.pedalOn ? 1 : 0;
+    params->circuitModel = defaults.circuitModel ? 1 : 0;
+}
+
+void fuzzColaEngineSetParams (FuzzColaEngineHandle* engine, const FuzzColaEngineParams* params)
+{
+    engine->engine.setParameters (toParameters (*params));
+}
+
+void fuzzColaEngineGetDefaultOptions (FuzzColaEngineRunOptions* options)
+{
+    const FuzzColaEngineOptions defaults;
+    options->offline = defaults.offline ? 1 : 0;
+    options->highQualityOffline = defaults.highQualityOffline ? 1 : 0;
+    options->offlineOversamplingStages = defaults.offlineOversamplingStages;
+    options->adaptiveQuality = defaults.adaptiveQuality ? 1 : 0;
+    options->cpuBudgetPercent = defaults.cpuBudgetPercent;
+}
+
+void fuzzColaEngineSetOptions (FuzzColaEngineHandle* engine, const FuzzColaEngineRunOptions* options)
+{
+    FuzzColaEngineOptions engineOptions;
+    engineOptions.offline = options->offline != 0;
+    engineOptions.highQualityOffline = options->highQualityOffline != 0;
+    engineOptions.offlineOversamplingStages = juce::jlimit (0, 3, options->offlineOversamplingStages);
+    engineOptions.adaptiveQuality = options->adaptiveQuality != 0;
+    engineOptions.cpuBudgetPercent = juce::jlimit (1.0f, 100.0f, options->cpuBudgetPercent);
+    engine->engine.setOptions (engineOptions);
+}
+
+void fuzzColaEngineProcessFloat (FuzzColaEngineHandle* engine, float* const* channels,
+                                 int numInputChannels, int numOutputChannels, int numSamples)
+{
+    engine->engine.process (channels, numInputChannels, numOutputChannels, numSamples);
+}
+
+void fuzzColaEngineProcessDouble (FuzzColaEngineHandle* engine, double* const* channels,
+                                  int numInputChannels, int numOutputChannels, int numSamples)
+{
+    engine->engine.process (channels, numInputChannels, numOutputChannels, numSamples);
+}
+
+int fuzzColaEngineGetLatencySamples (const FuzzColaEngineHandle* engine)
+{
+    return engine->engine.getLatencyInSamples();
+}
+
+double fuzzColaEngineGetTailLengthSeconds (const FuzzColaEngineHandle* engine)
+{
+    return engine->engine.getTailLengthSeconds();
+}
+
+int fuzzColaEngineLoadImpulseResponse (FuzzColaEngineHandle* engine, const char* path)
+{
+    // relative paths are from the working directory
+    const auto file = juce::File::getCurrentWorkingDirectory().getChildFile (juce::String (juce::CharPointer_UTF8 (path)));
+    return engine->engine.loadImpulseResponse (file) ? 1 : 0;
+}
+
+void fuzzColaEngineClearImpulseResponse (FuzzColaEngineHandle* engine)
+{
+    engine->engine.setImpulseResponse (nullptr);
+}
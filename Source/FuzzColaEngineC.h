@@ -0,0 +1,78 @@
+/*
+ ==============================================================================
+
+ FuzzColaEngineC.h
+ C API for FuzzColaEngine, for embedding the pedal without a plugin host.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One engine instance. Same threading rules as FuzzColaEngine: create, prepare and loading an
+// impulse response off the audio thread, everything else from whichever thread processes
+typedef struct FuzzColaEngineHandle FuzzColaEngineHandle;
+
+// FuzzColaParameters, with ints for the switches (0 = off)
+typedef struct FuzzColaEngineParams
+{
+    float sustain;                  // 0 .. 1
+    float tone;                     // 0 .. 1, dark .. bright
+    float volumeDb;
+    int toneEnabled;
+    int oversamplingStages;         // 0 = off, 1 = 2x, 2 = 4x, 3 = 8x
+    int linearPhaseOversampling;
+    int adaaOrder;                  // 0 = off, 1 = 1st order, 2 = 2nd order
+    int useClipTable;
+    int exactClippers;
+    int pedalOn;
+    int circuitModel;               // 0 = the classic engine, 1 = the wave digital circuit
+} FuzzColaEngineParams;
+
+// FuzzColaEngineOptions, how the engine runs
+typedef struct FuzzColaEngineRunOptions
+{
+    int offline;
+    int highQualityOffline;
+    int offlineOversamplingStages;
+    int adaptiveQuality;
+    float cpuBudgetPercent;
+} FuzzColaEngineRunOptions;
+
+FuzzColaEngineHandle* fuzzColaEngineCreate (void);
+void fuzzColaEngineDestroy (FuzzColaEngineHandle* engine);
+
+void fuzzColaEnginePrepare (FuzzColaEngineHandle* engine, double sampleRate, int maximumBlockSize);
+void fuzzColaEngineReset (FuzzColaEngineHandle* engine);
+
+// the defaults are the plugin's
+void fuzzColaEngineGetDefaultParams (FuzzColaEngineParams* params);
+void fuzzColaEngineSetParams (FuzzColaEngineHandle* engine, const FuzzColaEngineParams* params);
+
+void fuzzColaEngineGetDefaultOptions (FuzzColaEngineRunOptions* options);
+void fuzzColaEngineSetOptions (FuzzColaEngineHandle* engine, const FuzzColaEngineRunOptions* options);
+
+// In place, any block size. channels holds numOutputChannels pointers, the first
+// numInputChannels (1 or 2, at most numOutputChannels) get processed, mono in / stereo out
+// copies the left side across
+void fuzzColaEngineProcessFloat (FuzzColaEngineHandle* engine, float* const* channels,
+                                 int numInputChannels, int numOutputChannels, int numSamples);
+void fuzzColaEngineProcessDouble (FuzzColaEngineHandle* engine, double* const* channels,
+                                  int numInputChannels, int numOutputChannels, int numSamples);
+
+int fuzzColaEngineGetLatencySamples (const FuzzColaEngineHandle* engine);
+double fuzzColaEngineGetTailLengthSeconds (const FuzzColaEngineHandle* engine);
+
+// Cabinet IR, path in UTF-8. Needs a prepare first (the IR gets resampled to that rate),
+// returns 0 if the file couldn't be read. A reset afterwards has it in from the first sample,
+// otherwise it fades in over the next process call
+int fuzzColaEngineLoadImpulseResponse (FuzzColaEngineHandle* engine, const char* path);
+void fuzzColaEngineClearImpulseResponse (FuzzColaEngineHandle* engine);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,80 @@
+/*
+ ==============================================================================
+
+ FuzzColaPresets.cpp
+ Factory presets and reading saved ones.
+
+ ==============================================================================
+ */
+
+#include "FuzzColaPresets.h"
+
+const juce::Array<FuzzColaFactoryPreset>& FuzzColaPresets::getFactoryPresets()
+{
+    static const juce::Array<FuzzColaFactoryPreset> presets
+    {
+        { "Wall Of Sound", 0.90f, 0.42f,  0.0f, true, true },
+        { "Scooped Rhythm", 0.72f, 0.30f, -3.0f, true, true },
+        { "Tight Lead", 0.60f, 0.65f, +2.0f, true, true },
+        { "Tone Bypass Hit", 0.85f, 0.50f,  0.0f, false,  true  }
+    };
+
+    return presets;
+}
+
+juce::File FuzzColaPresets::getUserPresetFolder()
+{
+    return juce::File::getSpecialLocation
+    (juce::File::userApplicationDataDirectory).getChildFile("SilverDSP").getChildFile("FuzzCola").getChildFile("Presets");
+}
+
+// Same mapping as the plugin's readParameters, from the stored values instead of the live ones
+bool FuzzColaPresets::readState (const juce::XmlElement& xml, FuzzColaPresetState& state)
+{
+    if (! xml.hasTagName ("Parameters"))
+        return false;
+
+    juce::NamedValueSet values;
+
+    for (auto* param : xml.getChildWithTagNameIterator ("PARAM"))
+        values.set (param->getStringAttribute ("id"), param->getDoubleAttribute ("value"));
+
+    auto get = [&values] (const char* paramID, double defaultValue)
+    {
+        return (double) values.getWithDefault (paramID, defaultValue);
+    };
+
+    FuzzColaParameters& parameters = state.parameters;
+    parameters.sustain = (float) get ("SUSTAIN", parameters.sustain);
+    parameters.tone = (float) get ("TONE", parameters.tone);
+    parameters.volumeDb = (float) get ("VOLUME", parameters.volumeDb);
+    parameters.toneEnabled = get ("TONEBYPASS", parameters.toneEnabled ? 1.0 : 0.0) > 0.5;
+    parameters.oversamplingStages = juce::jlimit (0, 3, (int) get ("OVERSAMPLE", parameters.oversamplingStages));
+    parameters.linearPhaseOversampling = get ("OSLINEARPHASE", parameters.linearPhaseOversampling ? 1.0 : 0.0) > 0.5;
+    parameters.adaaOrder = juce::jlimit (0, 2, (int) get ("ADAA", parameters.adaaOrder));
+    parameters.useClipTable = get ("CLIPTABLE", parameters.useClipTable ? 1.0 : 0.0) > 0.5;
+    parameters.pedalOn = get ("PEDALON", parameters.pedalOn ? 1.0 : 0.0) > 0.5;
+    parameters.circuitModel = (int) get ("ENGINE", parameters.circuitModel ? 1.0 : 0.0) == 1;
+
+    FuzzColaEngineOptions& options = state.options;
+    options.highQualityOffline = get ("RENDERHQ", options.highQualityOffline ? 1.0 : 0.0) > 0.5;
+    options.offlineOversamplingStages = juce::jlimit (0, 3, (int) get ("RENDEROVERSAMPLE", options.offlineOversamplingStages));
+    options.adaptiveQuality = get ("ADAPTIVEQUALITY", options.adaptiveQuality ? 1.0 : 0.0) > 0.5;
+    options.cpuBudgetPercent = (float) get ("CPUBUDGET", options.cpuBudgetPercent);
+
+    state.cabinetEnabled = get ("CABINET", state.cabinetEnabled ? 1.0 : 0.0) > 0.5;
+
+    const juce::String irPath = xml.getStringAttribute ("IRFILE");
+    state.impulseResponse = juce::File::isAbsolutePath (irPath) ? juce::File (irPath) : juce::File();
+
+    return true;
+}
+
+bool FuzzColaPresets::readStateFromFile (const juce::File& file, FuzzColaPresetState& state)
+{
+    if (! file.existsAsFile())
+        return false;
+
+    std::unique_ptr<juce::XmlElement> xml (juce::XmlDocument::parse (file));
+    return xml != nullptr && readState (*xml, state);
+}
@@ -0,0 +1,56 @@
+/*
+ ==============================================================================
+
+ FuzzColaPresets.h
+ The factory presets and the saved preset format, without the plugin.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include "FuzzColaEngine.h"
+
+// One factory preset, only the knobs and switches on the pedal itself, the rest stays as it is
+struct FuzzColaFactoryPreset
+{
+    juce::String name;
+    float sustain = 0.5f;
+    float tone = 0.5f;
+    float volumeDb = 0.8f;
+    bool toneEnabled = true;
+    bool pedalOn = true;
+
+    void applyTo (FuzzColaParameters& parameters) const noexcept
+    {
+        parameters.sustain = sustain;
+        parameters.tone = tone;
+        parameters.volumeDb = volumeDb;
+        parameters.toneEnabled = toneEnabled;
+        parameters.pedalOn = pedalOn;
+    }
+};
+
+// What the plugin's presets and sessions hold, as the engine takes it
+struct FuzzColaPresetState
+{
+    FuzzColaParameters parameters;
+    FuzzColaEngineOptions options;     // the offline render and adaptive quality settings
+    bool cabinetEnabled = false;
+    juce::File impulseResponse;        // IRFILE, might not exist
+};
+
+namespace FuzzColaPresets
+{
+    // the plugin's, in its menu order
+    const juce::Array<FuzzColaFactoryPreset>& getFactoryPresets();
+
+    // where the plugin saves user presets
+    juce::File getUserPresetFolder();
+
+    // A preset file or session state as the plugin writes it: the APVTS tree as XML, PARAM children
+    // with id and the actual (not normalised) value, IRFILE on the root. Anything missing keeps its
+    // default, so older presets still load. False if it isn't one of ours
+    bool readState (const juce::XmlElement& xml, FuzzColaPresetState& state);
+    bool readStateFromFile (const juce::File& file, FuzzColaPresetState& state);
+}
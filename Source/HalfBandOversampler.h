@@ -0,0 +1,536 @@
+/*
+ ==============================================================================
+
+ HalfBandOversampler.h
+ Polyphase half-band oversampling that only wraps the clipper stages.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+// Cascade of 2x half-band stages (2x / 4x / 8x), each stage in two flavours:
+//  - IIR: two parallel chains of first order allpasses (polyphase, min-phase-ish, very cheap)
+//  - Linear phase: Kaiser windowed half-band FIR, every other tap is zero so polyphase halves the work
+// Everything is allocated in prepare(), the audio thread only ever moves pointers around.
+template <typename SampleType>
+class HalfBandOversampler
+{
+    public:
+    enum class FilterType
+    {
+        iir = 0,
+        linearPhase
+    };
+
+    static constexpr int maxStages = 3; // 8x
+
+    HalfBandOversampler()
+    {
+        // Stage 1 sits right next to the audio band so it needs a steep transition,
+        // later stages only have to reject images that are already far away from it
+        for (int s = 0; s < maxStages; ++s)
+        {
+            const double transition = s == 0 ? 0.05 : (s == 1 ? 0.2 : 0.3);
+            iirCoefs[(size_t) s] = designAllpassHalfBand (transition, s == 0 ? 100.0 : 90.0);
+            firTaps[(size_t) s] = designFIRHalfBand (transition, s == 0 ? 90.0 : 80.0);
+        }
+    }
+
+    // Allocates state and scratch for the worst case (8x), call from prepareToPlay
+    void prepare (int numChannels, int maximumBlockSize)
+    {
+        maxBlockSize = std::max (1, maximumBlockSize);
+
+        channels.resize ((size_t) std::max (1, numChannels));
+
+        for (auto& ch : channels)
+        {
+            for (int s = 0; s < maxStages; ++s)
+            {
+                ch.iir[(size_t) s].prepare (iirCoefs[(size_t) s]);
+                ch.fir[(size_t) s].prepare (firTaps[(size_t) s]);
+            }
+
+            ch.bufferA.assign ((size_t) (maxBlockSize << maxStages), SampleType (0));
+            ch.bufferB.assign ((size_t) (maxBlockSize << maxStages), SampleType (0));
+        }
+
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& ch : channels)
+        {
+            for (auto& st : ch.iir)
+                st.reset();
+
+            for (auto& st : ch.fir)
+                st.reset();
+        }
+    }
+
+    // Clears one channel's history, the others carry on
+    void resetChannel (int channel)
+    {
+        auto& ch = channels[(size_t) channel];
+
+        for (auto& st : ch.iir)
+            st.reset();
+
+        for (auto& st : ch.fir)
+            st.reset();
+    }
+
+    // Picks a channel up exactly where another one is, for when one channel has been
+    // standing in for both (same sized histories on both sides, so this never allocates)
+    void copyChannelState (int source, int destination)
+    {
+        const auto& from = channels[(size_t) source];
+        auto& to = channels[(size_t) destination];
+
+        to.iir = from.iir;
+        to.fir = from.fir;
+    }
+
+    // Takes over another oversampler's mode and filter state (both prepared the same, so the
+    // histories are the same size and nothing allocates), the scratch buffers aren't copied
+    void copyStateFrom (const HalfBandOversampler& other)
+    {
+        numStages = other.numStages;
+        filterType = other.filterType;
+
+        for (size_t c = 0; c < std::min (channels.size(), other.channels.size()); ++c)
+        {
+            channels[c].iir = other.channels[c].iir;
+            channels[c].fir = other.channels[c].fir;
+        }
+    }
+
+    // numStages 0 = off, 1 = 2x, 2 = 4x, 3 = 8x
+    // Switching resets the state of the stages so we don't get garbage from old history
+    void setMode (int newNumStages, FilterType newType)
+    {
+        newNumStages = std::clamp (newNumStages, 0, maxStages);
+
+        if (newNumStages == numStages && newType == filterType)
+            return;
+
+        numStages = newNumStages;
+        filterType = newType;
+        reset();
+    }
+
+    int getNumStages() const { return numStages; }
+    int getFactor() const { return 1 << numStages; }
+    FilterType getFilterType() const { return filterType; }
+    int getMaximumBlockSize() const { return maxBlockSize; }
+
+    // Round trip (up + down) latency at the base rate
+    double getLatencyInSamples() const
+    {
+        return getLatencyInSamples (numStages, filterType);
+    }
+
+    double getLatencyInSamples (int stages, FilterType type) const
+    {
+        double latency = 0.0;
+
+        // A stage running between 2^s and 2^(s+1) times the base rate adds its delay twice
+        // (once up, once down) measured in samples at the higher rate
+        for (int s = 0; s < stages; ++s)
+        {
+            const double delayAtHighRate = type == FilterType::iir ? allpassGroupDelay (iirCoefs[(size_t) s])
+                                                                   : (double) (firTaps[(size_t) s].size() - 1) * 0.5;
+            latency += 2.0 * delayAtHighRate / (double) (2 << s);
+        }
+
+        return latency;
+    }
+
+    // Upsamples numSamples (<= maximumBlockSize) of one channel, returns the
+    // oversampled block which holds numSamples * getFactor() samples
+    SampleType* processUp (int channel, const SampleType* input, int numSamples)
+    {
+        auto& ch = channels[(size_t) channel];
+
+        const SampleType* src = input;
+        SampleType* dst = ch.bufferA.data();
+        int n = numSamples;
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            if (filterType == FilterType::iir)
+                ch.iir[(size_t) s].processUp (src, dst, n);
+            else
+                ch.fir[(size_t) s].processUp (src, dst, n);
+
+            src = dst;
+            dst = (dst == ch.bufferA.data()) ? ch.bufferB.data() : ch.bufferA.data();
+            n *= 2;
+        }
+
+        ch.upsampled = const_cast<SampleType*> (src);
+        return ch.upsampled;
+    }
+
+    // Brings the block returned by processUp() back down into output
+    void processDown (int channel, SampleType* output, int numSamples)
+    {
+        auto& ch = channels[(size_t) channel];
+
+        if (numStages == 0)
+        {
+            if (ch.upsampled != output)
+                std::copy (ch.upsampled, ch.upsampled + numSamples, output);
+
+            return;
+        }
+
+        // Decimation can safely run in place, so just walk back down the same buffer
+        SampleType* data = ch.upsampled;
+        int n = numSamples << numStages;
+
+        for (int s = numStages - 1; s >= 0; --s)
+        {
+            n /= 2;
+            SampleType* dst = (s == 0) ? output : data;
+
+            if (filterType == FilterType::iir)
+                ch.iir[(size_t) s].processDown (data, dst, n);
+            else
+                ch.fir[(size_t) s].processDown (data, dst, n);
+        }
+    }
+
+    private:
+    //==============================================================================
+    // Two allpass chains in parallel, one per polyphase branch
+    // Coefficient design follows Laurent de Soras' hiir (elliptic half-band, WTFPL)
+    struct AllpassStage
+    {
+        void prepare (const std::vector<double>& designed)
+        {
+            coefs.clear();
+
+            for (auto c : designed)
+                coefs.push_back ((SampleType) c);
+
+            upX.assign (coefs.size(), SampleType (0));
+            upY.assign (coefs.size(), SampleType (0));
+            downX.assign (coefs.size(), SampleType (0));
+            downY.assign (coefs.size(), SampleType (0));
+        }
+
+        void reset()
+        {
+            std::fill (upX.begin(), upX.end(), SampleType (0));
+            std::fill (upY.begin(), upY.end(), SampleType (0));
+            std::fill (downX.begin(), downX.end(), SampleType (0));
+            std::fill (downY.begin(), downY.end(), SampleType (0));
+        }
+
+        // Even coefficients feed branch 0, odd ones branch 1
+        static void runBranches (SampleType& even, SampleType& odd, const std::vector<SampleType>& c,
+                                 SampleType* x, SampleType* y)
+        {
+            const size_t numCoefs = c.size();
+            size_t i = 0;
+
+            for (; i + 1 < numCoefs; i += 2)
+            {
+                const SampleType e = (even - y[i]) * c[i] + x[i];
+                x[i] = even;
+                y[i] = e;
+                even = e;
+
+                const SampleType o = (odd - y[i + 1]) * c[i + 1] + x[i + 1];
+                x[i + 1] = odd;
+                y[i + 1] = o;
+                odd = o;
+            }
+
+            if (i < numCoefs)
+            {
+                const SampleType e = (even - y[i]) * c[i] + x[i];
+                x[i] = even;
+                y[i] = e;
+                even = e;
+            }
+        }
+
+        void processUp (const SampleType* in, SampleType* out, int numIn)
+        {
+            for (int i = 0; i < numIn; ++i)
+            {
+                SampleType even = in[i];
+                SampleType odd = in[i];
+                runBranches (even, odd, coefs, upX.data(), upY.data());
+                out[2 * i] = even;
+                out[2 * i + 1] = odd;
+            }
+        }
+
+        void processDown (const SampleType* in, SampleType* out, int numOut)
+        {
+            for (int i = 0; i < numOut; ++i)
+            {
+                SampleType even = in[2 * i + 1];
+                SampleType odd = in[2 * i];
+                runBranches (even, odd, coefs, downX.data(), downY.data());
+                out[i] = SampleType (0.5) * (even + odd);
+            }
+        }
+
+        std::vector<SampleType> coefs, upX, upY, downX, downY;
+    };
+
+    //==============================================================================
+    // Half-band FIR: h[centre] = 0.5 and every even distance from the centre is zero,
+    // so one polyphase branch is a plain delay and the other is half the taps
+    struct FIRStage
+    {
+        void prepare (const std::vector<double>& taps)
+        {
+            const int centre = (int) (taps.size() - 1) / 2;
+
+            branchTaps.clear();
+
+            for (size_t k = 0; k < taps.size(); k += 2)
+                branchTaps.push_back ((SampleType) taps[k]);
+
+            numBranchTaps = (int) branchTaps.size();
+            delayHalf = (centre - 1) / 2;
+            oddDelay = (centre + 1) / 2;
+
+            // doubled history so the convolution always reads one contiguous run
+            upHistory.assign ((size_t) numBranchTaps * 2, SampleType (0));
+            downEvenHistory.assign ((size_t) numBranchTaps * 2, SampleType (0));
+            downOddHistory.assign ((size_t) (oddDelay + 1) * 2, SampleType (0));
+
+            reset();
+        }
+
+        void reset()
+        {
+            std::fill (upHistory.begin(), upHistory.end(), SampleType (0));
+            std::fill (downEvenHistory.begin(), downEvenHistory.end(), SampleType (0));
+            std::fill (downOddHistory.begin(), downOddHistory.end(), SampleType (0));
+            upPos = downEvenPos = downOddPos = 0;
+        }
+
+        // convolves the branch taps with the newest numBranchTaps values, newest first
+        SampleType convolve (const SampleType* newestFirst) const
+        {
+            SampleType acc (0);
+
+            for (int k = 0; k < numBranchTaps; ++k)
+                acc += branchTaps[(size_t) k] * newestFirst[k];
+
+            return acc;
+        }
+
+        // pushes into a doubled ring buffer, returns pointer to the newest sample with older ones after it
+        static const SampleType* push (std::vector<SampleType>& history, int& pos, SampleType x)
+        {
+            const int length = (int) history.size() / 2;
+            pos = (pos == 0 ? length : pos) - 1;
+            history[(size_t) pos] = x;
+            history[(size_t) (pos + length)] = x;
+            return history.data() + pos;
+        }
+
+        void processUp (const SampleType* in, SampleType* out, int numIn)
+        {
+            for (int i = 0; i < numIn; ++i)
+            {
+                const SampleType* h = push (upHistory, upPos, in[i]);
+
+                // zero stuffing halves the level so the interpolator needs a gain of 2
+                out[2 * i] = SampleType (2) * convolve (h);
+                out[2 * i + 1] = h[delayHalf];
+            }
+        }
+
+        void processDown (const SampleType* in, SampleType* out, int numOut)
+        {
+            for (int i = 0; i < numOut; ++i)
+            {
+                const SampleType even = in[2 * i];
+                const SampleType odd = in[2 * i + 1];
+
+                const SampleType* h = push (downEvenHistory, downEvenPos, even);
+                const SampleType* o = push (downOddHistory, downOddPos, odd);
+
+                out[i] = convolve (h) + SampleType (0.5) * o[oddDelay];
+            }
+        }
+
+        std::vector<SampleType> branchTaps, upHistory, downEvenHistory, downOddHistory;
+        int numBranchTaps = 0, delayHalf = 0, oddDelay = 0;
+        int upPos = 0, downEvenPos = 0, downOddPos = 0;
+    };
+
+    //==============================================================================
+    // transition = normalised transition width at the stage's higher rate (band is 0.25 +- transition / 2)
+    static std::vector<double> designAllpassHalfBand (double transition, double attenuationDb)
+    {
+        const double pi = 3.14159265358979323846;
+
+        // transition parameters
+        double k = std::tan ((1.0 - transition * 2.0) * pi / 4.0);
+        k *= k;
+        const double kksqrt = std::pow (1.0 - k * k, 0.25);
+        const double e = 0.5 * (1.0 - kksqrt) / (1.0 + kksqrt);
+        const double e4 = e * e * e * e;
+        const double q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+
+        // filter order needed for the attenuation
+        const double attn = std::pow (10.0, -attenuationDb / 10.0);
+        const double a = attn / (1.0 - attn);
+        int order = (int) std::ceil (std::log (a * a / 16.0) / std::log (q));
+
+        if ((order & 1) == 0)
+            ++order;
+
+        order = std::max (order, 3);
+
+        const int numCoefs = (order - 1) / 2;
+        std::vector<double> coefs ((size_t) numCoefs);
+
+        for (int index = 0; index < numCoefs; ++index)
+        {
+            const double c = index + 1;
+
+            double num = 0.0;
+            {
+                int i = 0;
+                double j = 1.0;
+                double term = 0.0;
+
+                do
+                {
+                    term = std::pow (q, (double) (i * (i + 1))) * std::sin ((i * 2 + 1) * c * pi / order) * j;
+                    num += term;
+                    j = -j;
+                    ++i;
+                }
+                while (std::abs (term) > 1e-100);
+            }
+
+            double den = 0.0;
+            {
+                int i = 1;
+                double j = -1.0;
+                double term = 0.0;
+
+                do
+                {
+                    term = std::pow (q, (double) (i * i)) * std::cos (i * 2 * c * pi / order) * j;
+                    den += term;
+                    j = -j;
+                    ++i;
+                }
+                while (std::abs (term) > 1e-100);
+            }
+
+            const double ww = num * std::pow (q, 0.25) / (den + 0.5);
+            const double wwsq = ww * ww;
+            const double x = std::sqrt ((1.0 - wwsq * k) * (1.0 - wwsq / k)) / (1.0 + wwsq);
+
+            coefs[(size_t) index] = (1.0 - x) / (1.0 + x);
+        }
+
+        return coefs;
+    }
+
+    // Low frequency group delay of the allpass pair at the higher rate, one way
+    // (each section is (c + z^-2) / (1 + c z^-2)). Branch 1's extra sample of delay doesn't count:
+    // processDown() hands the even branch in[2i + 1], one sample early, which cancels it
+    // (FuzzColaBench --check-latency measures it against an impulse)
+    static double allpassGroupDelay (const std::vector<double>& coefs)
+    {
+        double branch0 = 0.0, branch1 = 0.0;
+
+        for (size_t i = 0; i < coefs.size(); ++i)
+            ((i & 1) == 0 ? branch0 : branch1) += 2.0 * (1.0 - coefs[i]) / (1.0 + coefs[i]);
+
+        return 0.5 * (branch0 + branch1);
+    }
+
+    static std::vector<double> designFIRHalfBand (double transition, double attenuationDb)
+    {
+        const double pi = 3.14159265358979323846;
+
+        // Kaiser's length estimate, rounded up to the 4k - 1 shape a half-band needs
+        const int estimate = (int) std::ceil ((attenuationDb - 7.95) / (14.36 * transition)) + 1;
+        const int halfBandK = std::max (2, (estimate + 4) / 4);
+        const int length = 4 * halfBandK - 1;
+        const int centre = (length - 1) / 2;
+
+        const double beta = attenuationDb > 50.0 ? 0.1102 * (attenuationDb - 8.7)
+                                                 : 0.5842 * std::pow (attenuationDb - 21.0, 0.4) + 0.07886 * (attenuationDb - 21.0);
+
+        auto besselI0 = [] (double x)
+        {
+            double sum = 1.0, term = 1.0;
+
+            for (int k = 1; k < 50; ++k)
+            {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+
+            return sum;
+        };
+
+        std::vector<double> taps ((size_t) length, 0.0);
+        double oddSum = 0.0;
+
+        for (int n = 0; n < length; ++n)
+        {
+            const int offset = n - centre;
+
+            if (offset == 0 || (offset & 1) == 0)
+                continue;
+
+            const double r = (double) offset / (double) centre;
+            const double window = besselI0 (beta * std::sqrt (1.0 - r * r)) / besselI0 (beta);
+            const double sinc = std::sin (pi * offset * 0.5) / (pi * offset);
+
+            taps[(size_t) n] = sinc * window;
+            oddSum += taps[(size_t) n];
+        }
+
+        // normalise so DC gain is exactly 1 (centre tap is 0.5, the rest must sum to 0.5)
+        for (int n = 0; n < length; ++n)
+            taps[(size_t) n] *= 0.5 / oddSum;
+
+        taps[(size_t) centre] = 0.5;
+
+        return taps;
+    }
+
+    //==============================================================================
+    struct Channel
+    {
+        std::array<AllpassStage, maxStages> iir;
+        std::array<FIRStage, maxStages> fir;
+        std::vector<SampleType> bufferA, bufferB;
+        SampleType* upsampled = nullptr;
+    };
+
+    std::array<std::vector<double>, maxStages> iirCoefs;
+    std::array<std::vector<double>, maxStages> firTaps;
+    std::vector<Channel> channels;
+
+    int maxBlockSize = 0;
+    int numStages = 0;
+    FilterType filterType = FilterType::iir;
+};
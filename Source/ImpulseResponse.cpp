@@ -0,0 +1,305 @@
+/*
+ ==============================================================================
+
+ ImpulseResponse.cpp
+ Loading, resampling and partitioning the cabinet IRs.
+
+ ==============================================================================
+ */
+
+#include "ImpulseResponse.h"
+
+#include <map>
+#include <mutex>
+
+ImpulseResponse::ImpulseResponse (std::vector<float> samples, juce::String irName)
+    : length ((int) samples.size()), name (std::move (irName))
+{
+    head.assign ((size_t) headSize, 0.0f);
+    std::copy (samples.begin(), samples.begin() + juce::jmin (length, headSize), head.begin());
+
+    shortPartitions = makePartitions (samples, headSize, longPartitionSize, shortPartitionSize);
+    longPartitions = makePartitions (samples, longPartitionSize, length, longPartitionSize);
+}
+
+int ImpulseResponse::getFftOrder (int partitionSize) noexcept
+{
+    return juce::roundToInt (std::log2 (2.0 * partitionSize));
+}
+
+// taps start .. end in blocks of size, each zero padded to the FFT length
+// (zeros in the second half is what makes the overlap-save in PartitionedConvolver work)
+ImpulseResponse::Partitions ImpulseResponse::makePartitions (const std::vector<float>& samples, int start, int end, int size)
+{
+    Partitions partitions;
+    partitions.size = size;
+
+    end = juce::jmin (end, (int) samples.size());
+
+    if (end <= start)
+        return partitions;
+
+    partitions.count = (end - start + size - 1) / size;
+    partitions.spectra.assign ((size_t) (partitions.count * 2 * partitions.getNumBins()), 0.0f);
+
+    juce::dsp::FFT fft (getFftOrder (size));
+    std::vector<float> buffer ((size_t) (4 * size));
+    const int numBins = partitions.getNumBins();
+
+    for (int p = 0; p < partitions.count; ++p)
+    {
+        const int first = start + p * size;
+        const int numTaps = juce::jmin (size, end - first);
+
+        std::fill (buffer.begin(), buffer.end(), 0.0f);
+        std::copy (samples.begin() + first, samples.begin() + first + numTaps, buffer.begin());
+        fft.performRealOnlyForwardTransform (buffer.data(), true);
+
+        float* spectrum = partitions.spectra.data() + (size_t) (p * 2 * numBins);
+
+        for (int b = 0; b < numBins; ++b)
+        {
+            spectrum[b] = buffer[(size_t) (2 * b)];
+            spectrum[numBins + b] = buffer[(size_t) (2 * b + 1)];
+        }
+    }
+
+    return partitions;
+}
+
+// Cached by path, modification time and sample rate, so an edited file gets read again.
+// Only weak references are kept, the IR goes once the last instance using it lets go
+std::shared_ptr<const ImpulseResponse> ImpulseResponse::getShared (const juce::File& file, double sampleRate)
+{
+    static std::mutex mutex;
+    static std::map<juce::String, std::weak_ptr<const ImpulseResponse>> cache;
+
+    const juce::String key = file.getFullPathName() + "|" + juce::String (file.getLastModificationTime().toMilliseconds())
+                           + "|" + juce::String (sampleRate);
+
+    {
+        const std::lock_guard<std::mutex> guard (mutex);
+
+        if (auto shared = cache[key].lock())
+            return shared;
+    }
+
+    // not under the lock, other instances can carry on with theirs while this one reads
+    auto loaded = load (file, sampleRate);
+
+    if (loaded == nullptr)
+        return nullptr;
+
+    const std::lock_guard<std::mutex> guard (mutex);
+    auto& cached = cache[key];
+
+    // another instance got there first, everyone gets that one
+    if (auto shared = cached.lock())
+        return shared;
+
+    cached = loaded;
+
+    for (auto it = cache.begin(); it != cache.end();)
+        it = it->second.expired() ? cache.erase (it) : std::next (it);
+
+    return loaded;
+}
+
+// Mono (stereo files get their channels averaged, so dual mono sharing still works), resampled,
+// cut to maxSeconds, trailing silence trimmed, and normalised to unit energy so a broadband
+// signal comes out at about the level it went in whatever IR is loaded
+std::shared_ptr<const ImpulseResponse> ImpulseResponse::load (const juce::File& file, double sampleRate)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0 || reader->numChannels == 0)
+        return nullptr;
+
+    const auto maxFileSamples = (juce::int64) std::ceil (maxSeconds * reader->sampleRate);
+    const bool truncated = reader->lengthInSamples > maxFileSamples;
+    const int fileLength = (int) juce::jmin (reader->lengthInSamples, maxFileSamples);
+
+    juce::AudioBuffer<float> buffer ((int) reader->numChannels, fileLength);
+    reader->read (&buffer, 0, fileLength, 0, true, true);
+
+    std::vector<float> samples ((size_t) fileLength, 0.0f);
+
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+        juce::FloatVectorOperations::addWithMultiply (samples.data(), buffer.getReadPointer (c),
+                                                      1.0f / (float) buffer.getNumChannels(), fileLength);
+
+    if (std::abs (reader->sampleRate - sampleRate) > 1.0e-6)
+        samples = resample (samples, reader->sampleRate, sampleRate);
+
+    // 10 ms fade where the file got cut, rather than a step
+    if (truncated)
+    {
+        const int fadeLength = juce::jmin ((int) samples.size(), (int) (0.01 * sampleRate));
+
+        for (int i = 0; i < fadeLength; ++i)
+            samples[samples.size() - 1 - (size_t) i] *= (float) i / (float) fadeLength;
+    }
+
+    // everything after the last tap above -100 dB (of the peak) is just cost
+    const auto range = juce::FloatVectorOperations::findMinAndMax (samples.data(), (int) samples.size());
+    const float floor = juce::jmax (-range.getStart(), range.getEnd()) * 1.0e-5f;
+    auto end = samples.size();
+
+    while (end > 0 && std::abs (samples[end - 1]) <= floor)
+        --end;
+
+    samples.resize (end);
+
+    double energy = 0.0;
+
+    for (const float s : samples)
+        energy += (double) s * (double) s;
+
+    if (energy <= 0.0)
+        return nullptr;
+
+    juce::FloatVectorOperations::multiply (samples.data(), (float) (1.0 / std::sqrt (energy)), (int) samples.size());
+
+    return std::make_shared<const ImpulseResponse> (std::move (samples), file.getFileNameWithoutExtension());
+}
+
+// Windowed sinc (Blackman, 32 zero crossings a side), band limited to whichever Nyquist is lower.
+// It's only ever a couple of seconds of IR, once per load, so plain direct evaluation is fine
+std::vector<float> ImpulseResponse::resample (const std::vector<float>& input, double fromRate, double toRate)
+{
+    const double ratio = toRate / fromRate;
+    const double cutoff = juce::jmin (1.0, ratio);          // as a fraction of the input's Nyquist
+    const double halfWidth = 32.0 / cutoff;                 // in input samples
+    const int inputLength = (int) input.size();
+    const int outputLength = (int) std::ceil (inputLength * ratio);
+    const double pi = juce::MathConstants<double>::pi;
+
+    std::vector<float> output ((size_t) outputLength, 0.0f);
+
+    for (int n = 0; n < outputLength; ++n)
+    {
+        const double centre = n / ratio;
+        const int first = juce::jmax (0, (int) std::ceil (centre - halfWidth));
+        const int last = juce::jmin (inputLength - 1, (int) std::floor (centre + halfWidth));
+        double sum = 0.0;
+
+        for (int k = first; k <= last; ++k)
+        {
+            const double t = k - centre;
+            const double x = pi * t * cutoff;
+            const double sinc = x == 0.0 ? 1.0 : std::sin (x) / x;
+            const double window = 0.42 + 0.5 * std::cos (pi * t / halfWidth) + 0.08 * std::cos (2.0 * pi * t / halfWidth);
+
+            sum += input[(size_t) k] * cutoff * sinc * window;
+        }
+
+        output[(size_t) n] = (float) sum;
+    }
+
+    return output;
+}
+
+//==============================================================================
+struct ImpulseResponseLoader::LoaderThread  : public juce::TimeSliceThread
+{
+    LoaderThread() : juce::TimeSliceThread ("Fuzz Cola IR Loader")
+    {
+        startThread (juce::Thread::Priority::low);
+    }
+
+    ~LoaderThread() override
+    {
+        stopThread (4000);
+    }
+};
+
+// nothing runs until the first setFile / setSampleRate, by then the callbacks are in place
+ImpulseResponseLoader::ImpulseResponseLoader()
+{
+}
+
+// waits for a load that's already running, so the callbacks never outlive their owner
+ImpulseResponseLoader::~ImpulseResponseLoader()
+{
+    thread->removeTimeSliceClient (this);
+}
+
+void ImpulseResponseLoader::setFile (const juce::File& newFile)
+{
+    {
+        const juce::ScopedLock sl (lock);
+        file = newFile;
+    }
+
+    thread->addTimeSliceClient (this);
+}
+
+void ImpulseResponseLoader::setSampleRate (double newSampleRate)
+{
+    {
+        const juce::ScopedLock sl (lock);
+        sampleRate = newSampleRate;
+    }
+
+    thread->addTimeSliceClient (this);
+}
+
+juce::File ImpulseResponseLoader::getFile() const
+{
+    const juce::ScopedLock sl (lock);
+    return file;
+}
+
+juce::String ImpulseResponseLoader::getLoadedName() const
+{
+    const juce::ScopedLock sl (lock);
+    return loadedName;
+}
+
+bool ImpulseResponseLoader::failedToLoad() const
+{
+    const juce::ScopedLock sl (lock);
+    return loadFailed;
+}
+
+// (Re)loads when the file or rate has changed, then passes on the IR or nullptr depending on the switch
+int ImpulseResponseLoader::useTimeSlice()
+{
+    juce::File wantedFile;
+    double wantedSampleRate = 0.0;
+
+    {
+        const juce::ScopedLock sl (lock);
+        wantedFile = file;
+        wantedSampleRate = sampleRate;
+    }
+
+    if (wantedSampleRate > 0.0 && (wantedFile != loadedFile || wantedSampleRate != loadedSampleRate))
+    {
+        loaded = wantedFile.existsAsFile() ? ImpulseResponse::getShared (wantedFile, wantedSampleRate) : nullptr;
+        loadedFile = wantedFile;
+        loadedSampleRate = wantedSampleRate;
+
+        const juce::ScopedLock sl (lock);
+        loadedName = loaded != nullptr ? loaded->getName() : juce::String();
+        loadFailed = loaded == nullptr && wantedFile != juce::File();
+    }
+
+    auto wanted = isEnabled != nullptr && isEnabled() ? loaded : nullptr;
+
+    if (wanted != sent)
+    {
+        sent = wanted;
+
+        if (onChange != nullptr)
+            onChange (wanted);
+    }
+
+    if (onIdle != nullptr)
+        onIdle();
+
+    return pollMilliseconds;
+}
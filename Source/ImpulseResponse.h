@@ -0,0 +1,113 @@
+/*
+ ==============================================================================
+
+ ImpulseResponse.h
+ Cabinet IRs: loaded, resampled and cut into partitions once, shared by every instance.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// One IR at one sample rate, ready for PartitionedConvolver (see there for how the pieces fit).
+// Never changes once it's built, so any number of instances can convolve with the same one
+class ImpulseResponse
+{
+    public:
+    // the first headSize taps run as a plain FIR (no latency), then shortPartitionSize FFT blocks
+    // up to longPartitionSize, then longPartitionSize blocks for the rest of it
+    static constexpr int headSize = 64;
+    static constexpr int shortPartitionSize = 64;
+    static constexpr int longPartitionSize = 1024;
+
+    // cab and small room IRs, anything longer gets cut (with a short fade)
+    static constexpr double maxSeconds = 2.0;
+
+    // One size of partition, as spectra ready to multiply: per partition size + 1 bins,
+    // all the real parts then all the imaginary ones
+    struct Partitions
+    {
+        int size = 0;       // samples per partition, the FFT is twice that
+        int count = 0;
+        std::vector<float> spectra;
+
+        int getNumBins() const noexcept { return size + 1; }
+        const float* getSpectrum (int index) const noexcept { return spectra.data() + (size_t) (index * 2 * getNumBins()); }
+    };
+
+    // samples already at the rate they'll be played at
+    ImpulseResponse (std::vector<float> samples, juce::String name);
+
+    // The same file at the same rate comes back as the same IR for every caller while anyone still
+    // holds it. Reads and resamples the file (slow, keep it off the audio thread), nullptr if it can't
+    static std::shared_ptr<const ImpulseResponse> getShared (const juce::File& file, double sampleRate);
+
+    int getLength() const noexcept { return length; }
+    const juce::String& getName() const noexcept { return name; }
+
+    const float* getHead() const noexcept { return head.data(); }     // headSize taps, zero padded
+    const Partitions& getShortPartitions() const noexcept { return shortPartitions; }
+    const Partitions& getLongPartitions() const noexcept { return longPartitions; }
+
+    // FFT order for a partition size (the FFT is twice as long as the partition)
+    static int getFftOrder (int partitionSize) noexcept;
+
+    private:
+    int length = 0;
+    juce::String name;
+    std::vector<float> head;
+    Partitions shortPartitions, longPartitions;
+
+    static Partitions makePartitions (const std::vector<float>& samples, int start, int end, int size);
+    static std::shared_ptr<const ImpulseResponse> load (const juce::File& file, double sampleRate);
+    static std::vector<float> resample (const std::vector<float>& input, double fromRate, double toRate);
+};
+
+// Keeps an instance's IR loaded in the background: follows the file and sample rate it's given
+// and the on/off switch it polls, and calls onChange (on the loader thread) with the IR the stage
+// should be running, nullptr for none. One thread does this for every instance
+class ImpulseResponseLoader  : private juce::TimeSliceClient
+{
+    public:
+    ImpulseResponseLoader();
+    ~ImpulseResponseLoader() override;
+
+    // message thread
+    void setFile (const juce::File& newFile);
+    void setSampleRate (double newSampleRate);
+
+    juce::File getFile() const;
+    juce::String getLoadedName() const;     // empty while nothing is loaded
+    bool failedToLoad() const;              // there's a file, but it couldn't be read
+
+    // set these before the first setSampleRate, both get called on the loader thread
+    std::function<bool()> isEnabled;
+    std::function<void (std::shared_ptr<const ImpulseResponse>)> onChange;
+    std::function<void()> onIdle;           // every poll, for freeing whatever the audio thread is done with
+
+    private:
+    struct LoaderThread;
+    juce::SharedResourcePointer<LoaderThread> thread;
+
+    static constexpr int pollMilliseconds = 50;
+
+    juce::CriticalSection lock;
+    juce::File file;
+    double sampleRate = 0.0;
+    juce::String loadedName;
+    bool loadFailed = false;
+
+    // loader thread only
+    juce::File loadedFile;
+    double loadedSampleRate = 0.0;
+    std::shared_ptr<const ImpulseResponse> loaded, sent;
+
+    int useTimeSlice() override;
+
+    JUCE_DECLARE_NON_COPYABLE (ImpulseResponseLoader)
+};
@@ -0,0 +1,97 @@
+/*
+ ==============================================================================
+
+ LaneFilters.h
+ Runs several mono TPT state variable filters as the lanes of one juce::dsp::SIMDRegister filter.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include "TptFilters.h"
+
+#if JUCE_USE_SIMD
+
+// Every channel runs the same stages with the same settings, so instead of one pass per
+// channel the channels go side by side in a SIMD register (2 of the 4 float lanes on SSE/NEON).
+// The pedal has at most two channels, so any more lanes than that just sit idle
+// Only the state variable filters (the pre-clipper HPF) go through here, everything after the
+// clippers runs per channel as a block state-space system (StateSpaceFilter.h).
+// The mono filters stay the owners of coefficients and state: pack() copies them into lanes
+// for a tile and unpack() hands the state back, so lane and mono processing can take turns
+// at any tile boundary. Unused lanes are left at zero and just produce zeros
+namespace LaneFilters
+{
+    template <typename SampleType>
+    using Lanes = juce::dsp::SIMDRegister<SampleType>;
+
+    template <typename SampleType>
+    Lanes<SampleType> packValues (const SampleType* values, size_t numLanes) noexcept
+    {
+        auto lanes = Lanes<SampleType>::expand (SampleType (0));
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+            lanes.set (lane, values[lane]);
+
+        return lanes;
+    }
+
+    template <typename SampleType>
+    TptSvf<Lanes<SampleType>> pack (TptSvf<SampleType>* const* filters, size_t numLanes) noexcept
+    {
+        jassert (numLanes <= Lanes<SampleType>::size());
+
+        SampleType a1[Lanes<SampleType>::size()], a2[Lanes<SampleType>::size()], a3[Lanes<SampleType>::size()];
+        SampleType m0[Lanes<SampleType>::size()], m1[Lanes<SampleType>::size()], m2[Lanes<SampleType>::size()];
+        SampleType s1[Lanes<SampleType>::size()], s2[Lanes<SampleType>::size()];
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            const auto& c = filters[lane]->getCoefficients();
+            const auto state = filters[lane]->getState();
+
+            a1[lane] = c.a1; a2[lane] = c.a2; a3[lane] = c.a3;
+            m0[lane] = c.m0; m1[lane] = c.m1; m2[lane] = c.m2;
+            s1[lane] = state.ic1eq; s2[lane] = state.ic2eq;
+        }
+
+        TptSvf<Lanes<SampleType>> lanes;
+        lanes.setCoefficients ({ packValues (a1, numLanes), packValues (a2, numLanes), packValues (a3, numLanes),
+                                 packValues (m0, numLanes), packValues (m1, numLanes), packValues (m2, numLanes) });
+        lanes.setState ({ packValues (s1, numLanes), packValues (s2, numLanes) });
+        return lanes;
+    }
+
+    template <typename SampleType>
+    void unpack (const TptSvf<Lanes<SampleType>>& lanes, TptSvf<SampleType>* const* filters, size_t numLanes) noexcept
+    {
+        const auto state = lanes.getState();
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+            filters[lane]->setState ({ state.ic1eq.get (lane), state.ic2eq.get (lane) });
+    }
+
+    // channel buffers <-> one register per sample, so the filter loop does aligned loads/stores only
+    template <typename SampleType>
+    void interleave (SampleType* const* channels, size_t numChannels, int numSamples, SampleType* laneBuffer) noexcept
+    {
+        constexpr size_t width = Lanes<SampleType>::size();
+
+        for (size_t channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                laneBuffer[(size_t) i * width + channel] = channels[channel][i];
+    }
+
+    template <typename SampleType>
+    void deinterleave (const SampleType* laneBuffer, SampleType* const* channels, size_t numChannels, int numSamples) noexcept
+    {
+        constexpr size_t width = Lanes<SampleType>::size();
+
+        for (size_t channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                channels[channel][i] = laneBuffer[(size_t) i * width + channel];
+    }
+}
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ ==============================================================================
+
+ PartitionedConvolver.h
+ Zero latency, non-uniformly partitioned convolution with a shared ImpulseResponse.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "ImpulseResponse.h"
+
+// The IR gets split three ways (sizes in ImpulseResponse), and the pieces just add up:
+//  - the first headSize taps as a direct form FIR, so the output has no latency at all
+//  - up to longPartitionSize, shortPartitionSize blocks through an overlap-save FFT. A block's
+//    result isn't needed until one block after it came in, which is exactly when it's ready
+//  - the rest in longPartitionSize blocks, same again, 16x fewer partitions to multiply per sample
+// so a 1 s IR costs about as much as 100 ms would uniformly partitioned at the short size.
+// The IR's spectra are shared, this only holds each channel's input history.
+// Allocates when it's constructed, after that nothing does. No IR = a straight wire
+class PartitionedConvolver
+{
+    public:
+    static constexpr int maxChannels = 2;
+
+    PartitionedConvolver() = default;
+
+    explicit PartitionedConvolver (std::shared_ptr<const ImpulseResponse> impulseResponse)
+        : impulse (std::move (impulseResponse))
+    {
+        if (impulse == nullptr)
+            return;
+
+        // The long stage's big FFT comes round once every longPartitionSize samples, every
+        // instance starts at a different point in that cycle so dozens of them don't all do it
+        // in the same block (both channels stay in step, for the dual mono sharing)
+        static std::atomic<int> nextInstance { 0 };
+        longPhase = (nextInstance++ % 16) * (ImpulseResponse::longPartitionSize / 16);
+
+        shortStage.prepare (impulse->getShortPartitions());
+        longStage.prepare (impulse->getLongPartitions());
+
+        for (auto& channel : channels)
+        {
+            channel.headInput.assign ((size_t) (ImpulseResponse::headSize - 1 + ImpulseResponse::shortPartitionSize), 0.0f);
+            shortStage.prepareChannel (channel.shortState, 0);
+            longStage.prepareChannel (channel.longState, longPhase);
+        }
+    }
+
+    bool isActive() const noexcept { return impulse != nullptr; }
+    int getLength() const noexcept { return impulse != nullptr ? impulse->getLength() : 0; }
+
+    void reset() noexcept
+    {
+        for (int c = 0; c < maxChannels; ++c)
+            resetChannel (c);
+    }
+
+    void resetChannel (int channel) noexcept
+    {
+        if (impulse == nullptr)
+            return;
+
+        auto& state = channels[(size_t) channel];
+        std::fill (state.headInput.begin(), state.headInput.end(), 0.0f);
+        shortStage.resetChannel (state.shortState, 0);
+        longStage.resetChannel (state.longState, longPhase);
+    }
+
+    // same sizes on both sides, so this is a plain copy (no allocation)
+    void copyChannelState (int from, int to) noexcept
+    {
+        channels[(size_t) to] = channels[(size_t) from];
+    }
+
+    // in place, any length
+    void process (int channel, float* data, int numSamples) noexcept
+    {
+        if (impulse == nullptr)
+            return;
+
+        auto& state = channels[(size_t) channel];
+        constexpr int headSize = ImpulseResponse::headSize;
+        const float* head = impulse->getHead();
+
+        for (int done = 0; done < numSamples;)
+        {
+            // never past the end of a block in either stage, that's where they do their FFTs
+            // (and never more than headInput has room for)
+            int length = juce::jmin (numSamples - done, ImpulseResponse::shortPartitionSize);
+
+            if (shortStage.isActive())
+                length = juce::jmin (length, shortStage.getSamplesToBlockEnd (state.shortState));
+
+            if (longStage.isActive())
+                length = juce::jmin (length, longStage.getSamplesToBlockEnd (state.longState));
+
+            float* out = data + done;
+            float* input = state.headInput.data() + headSize - 1;   // the last headSize - 1 inputs are right in front
+            std::copy (out, out + length, input);
+
+            // head, tap by tap across the block so the inner loop vectorises
+            std::fill (out, out + length, 0.0f);
+
+            for (int k = 0; k < headSize; ++k)
+                juce::FloatVectorOperations::addWithMultiply (out, input - k, head[k], length);
+
+            if (shortStage.isActive())
+                shortStage.process (state.shortState, input, out, length);
+
+            if (longStage.isActive())
+                longStage.process (state.longState, input, out, length);
+
+            std::copy (input + length - (headSize - 1), input + length, state.headInput.data());
+            done += length;
+        }
+    }
+
+    private:
+    // One partition size, uniformly partitioned overlap-save. The FFT and its scratch are shared
+    // by the channels (they run one after the other), the rest is per channel
+    struct Stage
+    {
+        struct ChannelState
+        {
+            std::vector<float> window;      // the last 2 * size inputs, what gets transformed
+            std::vector<float> history;     // one input spectrum per partition, split like the IR's
+            std::vector<float> output;      // this stage's share of the next size outputs
+            int position = 0;
+            int newest = 0;
+        };
+
+        const ImpulseResponse::Partitions* partitions = nullptr;
+        std::unique_ptr<juce::dsp::FFT> fft;
+        std::vector<float> buffer, accumulator;
+
+        bool isActive() const noexcept { return partitions != nullptr && partitions->count > 0; }
+        int getSamplesToBlockEnd (const ChannelState& state) const noexcept { return partitions->size - state.position; }
+
+        void prepare (const ImpulseResponse::Partitions& irPartitions)
+        {
+            partitions = &irPartitions;
+
+            if (! isActive())
+                return;
+
+            fft = std::make_unique<juce::dsp::FFT> (ImpulseResponse::getFftOrder (partitions->size));
+            buffer.assign ((size_t) (4 * partitions->size), 0.0f);
+            accumulator.assign ((size_t) (2 * partitions->getNumBins()), 0.0f);
+        }
+
+        void prepareChannel (ChannelState& state, int phase)
+        {
+            if (! isActive())
+                return;
+
+            state.window.resize ((size_t) (2 * partitions->size));
+            state.history.resize (partitions->spectra.size());
+            state.output.resize ((size_t) partitions->size);
+            resetChannel (state, phase);
+        }
+
+        void resetChannel (ChannelState& state, int phase) noexcept
+        {
+            std::fill (state.window.begin(), state.window.end(), 0.0f);
+            std::fill (state.history.begin(), state.history.end(), 0.0f);
+            std::fill (state.output.begin(), state.output.end(), 0.0f);
+            state.position = phase;
+            state.newest = 0;
+        }
+
+        // adds this stage's output for the block and takes its input, never past a block end
+        void process (ChannelState& state, const float* input, float* out, int length) noexcept
+        {
+            const int size = partitions->size;
+
+            juce::FloatVectorOperations::add (out, state.output.data() + state.position, length);
+            std::copy (input, input + length, state.window.data() + size + state.position);
+            state.position += length;
+
+            if (state.position == size)
+                processBlock (state);
+        }
+
+        // The newest input block goes into the history as a spectrum, every partition gets
+        // multiplied with the input block it lines up with, and the second half of the inverse
+        // is the next block of output (the first half is circular wrap, thrown away)
+        void processBlock (ChannelState& state) noexcept
+        {
+            const int size = partitions->size;
+            const int numBins = partitions->getNumBins();
+            const int count = partitions->count;
+
+            std::copy (state.window.begin(), state.window.end(), buffer.begin());
+            std::fill (buffer.begin() + 2 * size, buffer.end(), 0.0f);
+            fft->performRealOnlyForwardTransform (buffer.data(), true);
+
+            state.newest = (state.newest + 1) % count;
+            float* newest = state.history.data() + (size_t) (state.newest * 2 * numBins);
+
+            for (int b = 0; b < numBins; ++b)
+            {
+                newest[b] = buffer[(size_t) (2 * b)];
+                newest[numBins + b] = buffer[(size_t) (2 * b + 1)];
+            }
+
+            float* sumRe = accumulator.data();
+            float* sumIm = accumulator.data() + numBins;
+            std::fill (accumulator.begin(), accumulator.end(), 0.0f);
+
+            for (int p = 0; p < count; ++p)
+            {
+                const float* h = partitions->getSpectrum (p);
+                const float* x = state.history.data() + (size_t) (((state.newest - p + count) % count) * 2 * numBins);
+
+                for (int b = 0; b < numBins; ++b)
+                {
+                    const float xr = x[b], xi = x[numBins + b];
+                    const float hr = h[b], hi = h[numBins + b];
+
+                    sumRe[b] += xr * hr - xi * hi;
+                    sumIm[b] += xr * hi + xi * hr;
+                }
+            }
+
+            for (int b = 0; b < numBins; ++b)
+            {
+                buffer[(size_t) (2 * b)] = sumRe[b];
+                buffer[(size_t) (2 * b + 1)] = sumIm[b];
+            }
+
+            fft->performRealOnlyInverseTransform (buffer.data());
+            std::copy (buffer.begin() + size, buffer.begin() + 2 * size, state.output.begin());
+
+            // this block becomes the first half of the next window
+            std::copy (state.window.begin() + size, state.window.end(), state.window.begin());
+            state.position = 0;
+        }
+    };
+
+    struct ChannelState
+    {
+        std::vector<float> headInput;       // headSize - 1 previous inputs, then the current piece
+        Stage::ChannelState shortState, longState;
+    };
+
+    std::shared_ptr<const ImpulseResponse> impulse;
+    Stage shortStage, longStage;
+    std::array<ChannelState, maxChannels> channels;
+    int longPhase = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (PartitionedConvolver)
+};
@@ -91,6 +91,13 @@ FuzzColaAudioProcessorEditor::FuzzColaAudioProcessorEditor (FuzzColaAudioProcess
     addAndMakeVisible(toneKnob);
     addAndMakeVisible(sustainKnob);
     
+    // Right click on a knob or switch for MIDI learn
+    sustainKnob.onRightClick = [this]() { showMidiLearnMenu("SUSTAIN"); };
+    toneKnob.onRightClick = [this]() { showMidiLearnMenu("TONE"); };
+    volumeKnob.onRightClick = [this]() { showMidiLearnMenu("VOLUME"); };
+    footswitch.onRightClick = [this]() { showMidiLearnMenu("PEDALON"); };
+    bypassToggle.onRightClick = [this]() { showMidiLearnMenu("TONEBYPASS"); };
+    
     // LED
     addAndMakeVisible(led);
     
@@ -130,6 +137,23 @@ FuzzColaAudioProcessorEditor::FuzzColaAudioProcessorEditor (FuzzColaAudioProcess
     // my attempt at refreshing preset box
     refreshPresetBox();
     
+    // Adaptive quality tier, hidden at full quality
+    qualityLabel.setFont (juce::FontOptions (12.0f));
+    qualityLabel.setJustificationType (juce::Justification::centredRight);
+    qualityLabel.setColour (juce::Label::textColourId, juce::Colours::white.withAlpha (0.7f));
+    qualityLabel.setInterceptsMouseClicks (false, false);
+    addChildComponent (qualityLabel);
+    
+    // Cabinet IR, on/off and the file are both in its menu
+    cabinetButton.setColour (juce::TextButton::buttonColourId, juce::Colours::black.withAlpha (0.5f));
+    cabinetButton.setColour (juce::TextButton::textColourOffId, juce::Colours::white);
+    cabinetButton.setColour (juce::ComboBox::outlineColourId, juce::Colours::white);
+    cabinetButton.onClick = [this]() { showCabinetMenu(); };
+    addAndMakeVisible (cabinetButton);
+    updateCabinetButton();
+    
+    startTimerHz (4);
+    
     // Sync local flags to parameter values, then update LED & graphics
     pedalEngaged = (*state.getRawParameterValue("PEDALON") > 0.5f);
     toneEnabled = (*state.getRawParameterValue("TONEBYPASS") > 0.5f);
@@ -226,6 +250,24 @@ void FuzzColaAudioProcessorEditor::resized()
     
     presetBox.setBounds (boxX, boxY, boxW, boxH);
     
+    qualityLabel.setBounds (getWidth() - 110, getHeight() - 22, 104, 18);
+    cabinetButton.setBounds (6, getHeight() - 22, 110, 18);
+    
+}
+
+void FuzzColaAudioProcessorEditor::timerCallback()
+{
+    // the IR loads in the background, so its name turns up a moment after picking it
+    updateCabinetButton();
+    
+    const int tier = audioProcessor.getQualityTier();
+    
+    if (tier == shownQualityTier)
+        return;
+    
+    shownQualityTier = tier;
+    qualityLabel.setText ("Eco Quality " + juce::String (tier), juce::dontSendNotification);
+    qualityLabel.setVisible (tier > 0);
 }
 
 void FuzzColaAudioProcessorEditor::buttonClicked(juce::Button* b)
@@ -348,6 +390,112 @@ void FuzzColaAudioProcessorEditor::handlePresetSelection()
     }
 }
 
+// Cabinet IR menu: the switch, picking a file, and clearing it
+void FuzzColaAudioProcessorEditor::showCabinetMenu()
+{
+    auto* cabinet = audioProcessor.getAPVTS().getParameter("CABINET");
+    const bool cabinetOn = cabinet->getValue() > 0.5f;
+    const bool hasFile = audioProcessor.getImpulseResponseFile() != juce::File{};
+    
+    juce::PopupMenu menu;
+    menu.addItem(1, "Cabinet IR", true, cabinetOn);
+    menu.addSeparator();
+    menu.addItem(2, "Load IR...");
+    menu.addItem(3, "Clear IR", hasFile);
+    
+    // the editor can be closed with the menu still open
+    juce::Component::SafePointer<FuzzColaAudioProcessorEditor> editor (this);
+    
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent (&cabinetButton),
+                       [editor, cabinet, cabinetOn](int result)
+    {
+        if (editor == nullptr || result == 0)
+            return;
+        
+        if (result == 1)
+            setCabinetParameter(*cabinet, ! cabinetOn);
+        else if (result == 2)
+            editor->chooseImpulseResponse();
+        else if (result == 3)
+            editor->audioProcessor.clearImpulseResponse();
+        
+        editor->updateCabinetButton();
+    });
+}
+
+void FuzzColaAudioProcessorEditor::chooseImpulseResponse()
+{
+    irChooser = std::make_unique<juce::FileChooser>("Load cabinet IR...", audioProcessor.getImpulseResponseFile(),
+                                                    "*.wav;*.aif;*.aiff;*.flac");
+    
+    // the chooser belongs to the editor, so it can't outlive it
+    irChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                           [this](const juce::FileChooser& fc)
+                           {
+        auto f = fc.getResult();
+        
+        // picking one means wanting to hear it
+        if (f.existsAsFile())
+        {
+            audioProcessor.loadImpulseResponse(f);
+            setCabinetParameter(*audioProcessor.getAPVTS().getParameter("CABINET"), true);
+        }
+        
+        updateCabinetButton();
+    });
+}
+
+void FuzzColaAudioProcessorEditor::setCabinetParameter (juce::RangedAudioParameter& cabinet, bool on)
+{
+    cabinet.beginChangeGesture();
+    cabinet.setValueNotifyingHost(on ? 1.0f : 0.0f);
+    cabinet.endChangeGesture();
+}
+
+void FuzzColaAudioProcessorEditor::updateCabinetButton()
+{
+    const bool cabinetOn = audioProcessor.getAPVTS().getRawParameterValue("CABINET")->load() > 0.5f;
+    const auto name = audioProcessor.getImpulseResponseName();
+    juce::String text;
+    
+    if (audioProcessor.getImpulseResponseFile() == juce::File{})
+        text = "No Cab IR";
+    else if (audioProcessor.impulseResponseFailedToLoad())
+        text = "IR failed to load";
+    else if (name.isEmpty())
+        text = "Loading IR...";
+    else
+        text = name;
+    
+    if (! cabinetOn)
+        text << " (off)";
+    
+    if (cabinetButton.getButtonText() != text)
+        cabinetButton.setButtonText(text);
+}
+
+// MIDI learn menu, learning picks up the next CC the plugin receives
+void FuzzColaAudioProcessorEditor::showMidiLearnMenu (const juce::String& paramID)
+{
+    const int controller = audioProcessor.getMidiMapping(paramID);
+    const bool learning = audioProcessor.isMidiLearning(paramID);
+    
+    juce::PopupMenu menu;
+    menu.addItem(1, learning ? "MIDI Learn (move a controller...)" : "MIDI Learn", true, learning);
+    menu.addItem(2, controller >= 0 ? "Clear MIDI CC " + juce::String (controller) : "No MIDI CC assigned", controller >= 0);
+    
+    // the processor outlives the editor, so the callback only holds on to that
+    auto& processor = audioProcessor;
+    
+    menu.showMenuAsync(juce::PopupMenu::Options(), [&processor, paramID](int result)
+    {
+        if (result == 1)
+            processor.startMidiLearn(paramID);
+        else if (result == 2)
+            processor.setMidiMapping(paramID, -1);
+    });
+}
+
 // Sync UI state from parameter values
 void FuzzColaAudioProcessorEditor::syncUiFromParams()
 {
@@ -85,6 +85,28 @@ struct ToggleImageButton : public juce::Button
     
     ToggleImageButton (const juce::String& name) : Button (name) {}
     
+    // right click goes here instead of toggling (MIDI learn menu)
+    std::function<void()> onRightClick;
+    
+    void mouseDown (const juce::MouseEvent& e) override
+    {
+        if (e.mods.isPopupMenu() && onRightClick != nullptr)
+        {
+            onRightClick();
+            return;
+        }
+        
+        Button::mouseDown (e);
+    }
+    
+    void mouseUp (const juce::MouseEvent& e) override
+    {
+        if (e.mods.isPopupMenu() && onRightClick != nullptr)
+            return;
+        
+        Button::mouseUp (e);
+    }
+    
     void setImages (const juce::Image& offImg, const juce::Image& onImg)
     {
         // Set images and repaint
@@ -122,6 +144,20 @@ class PopupNumericSlider : public juce::Slider
         setPopupDisplayEnabled(true, true, parent);
     }
     
+    // right click goes here instead of turning the knob (MIDI learn menu)
+    std::function<void()> onRightClick;
+    
+    void mouseDown (const juce::MouseEvent& e) override
+    {
+        if (e.mods.isPopupMenu() && onRightClick != nullptr)
+        {
+            onRightClick();
+            return;
+        }
+        
+        juce::Slider::mouseDown (e);
+    }
+    
     // Upon a quick google search juce::Slider has a function for double click to reset to default value so I overrode it
     void mouseDoubleClick (const juce::MouseEvent& e) override
     {
@@ -216,6 +252,7 @@ class PopupNumericSlider : public juce::Slider
 class FuzzColaAudioProcessorEditor  : public juce::AudioProcessorEditor
 , private juce::Slider::Listener
 , private juce::Button::Listener
+, private juce::Timer
 {
     public:
     FuzzColaAudioProcessorEditor (FuzzColaAudioProcessor&);
@@ -238,6 +275,22 @@ class FuzzColaAudioProcessorEditor  : public juce::AudioProcessorEditor
     void refreshPresetBox();
     void handlePresetSelection();
     
+    // right click menu on the knobs and switches
+    void showMidiLearnMenu (const juce::String& paramID);
+    
+    // shows the adaptive quality tier while the pedal is running below full quality
+    juce::Label qualityLabel;
+    int shownQualityTier = -1;
+    void timerCallback() override;
+    
+    // cabinet IR: the button shows what's loaded and opens the menu for it
+    juce::TextButton cabinetButton;
+    std::unique_ptr<juce::FileChooser> irChooser;
+    void showCabinetMenu();
+    void chooseImpulseResponse();
+    void updateCabinetButton();
+    static void setCabinetParameter (juce::RangedAudioParameter& cabinet, bool on);
+    
     // Select user preset in combo box based on file
     void selectUserPresetByFile (const juce::File& f)
     {
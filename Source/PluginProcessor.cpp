@@ -23,12 +23,51 @@ FuzzColaAudioProcessor::FuzzColaAudioProcessor()
 apvts (*this, nullptr, "Parameters", createParameterLayout())
 #endif
 {
-    buildFactoryPresets();
+    sustainParam = apvts.getRawParameterValue ("SUSTAIN");
+    toneParam = apvts.getRawParameterValue ("TONE");
+    volumeParam = apvts.getRawParameterValue ("VOLUME");
+    pedalOnParam = apvts.getRawParameterValue ("PEDALON");
+    toneBypassParam = apvts.getRawParameterValue ("TONEBYPASS");
+    oversampleParam = apvts.getRawParameterValue ("OVERSAMPLE");
+    osLinearPhaseParam = apvts.getRawParameterValue ("OSLINEARPHASE");
+    adaaParam = apvts.getRawParameterValue ("ADAA");
+    clipTableParam = apvts.getRawParameterValue ("CLIPTABLE");
+    renderQualityParam = apvts.getRawParameterValue ("RENDERHQ");
+    renderOversampleParam = apvts.getRawParameterValue ("RENDEROVERSAMPLE");
+    adaptiveQualityParam = apvts.getRawParameterValue ("ADAPTIVEQUALITY");
+    cpuBudgetParam = apvts.getRawParameterValue ("CPUBUDGET");
+    cabinetParam = apvts.getRawParameterValue ("CABINET");
+    engineParam = apvts.getRawParameterValue ("ENGINE");
+    bypassParam = apvts.getRawParameterValue ("BYPASS");
+    
+    pedalOnParameter = apvts.getParameter ("PEDALON");
+    bypassParameter = apvts.getParameter ("BYPASS");
+    apvts.addParameterListener ("PEDALON", this);
+    apvts.addParameterListener ("BYPASS", this);
+    
+    jassert (getMidiLearnableParameters().size() == numMidiLearnableParameters);
+    
+    for (int i = 0; i < numMidiLearnableParameters; ++i)
+        midiLearnableParams[(size_t) i] = apvts.getParameter (getMidiLearnableParameters()[i]);
+    
+    // the loader hands the engine the IR (or nullptr while CABINET is off) and collects
+    // whatever it's swapped out, so neither ever happens on the audio thread
+    irLoader.isEnabled = [this] { return cabinetParam->load (std::memory_order_relaxed) > 0.5f; };
+    irLoader.onChange = [this] (std::shared_ptr<const ImpulseResponse> ir) { engine.setImpulseResponse (std::move (ir)); };
+    irLoader.onIdle = [this] { engine.releaseRetiredCabinet(); };
+    
+    for (auto& mapping : midiMappings)
+        mapping = -1;
+    
+    setMidiMapping ("PEDALON", defaultFootswitchController);
+    
     getPresetFolder().createDirectory();
 }
 
 FuzzColaAudioProcessor::~FuzzColaAudioProcessor()
 {
+    apvts.removeParameterListener ("PEDALON", this);
+    apvts.removeParameterListener ("BYPASS", this);
 }
 
 // Parameter Layout
@@ -51,6 +90,48 @@ FuzzColaAudioProcessor::createParameterLayout()
     
     layout.add (std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "TONEBYPASS", 1 }, "Tone Enabled", true));
     
+    // Oversampling of the clipper stages, off keeps the original zero latency sound
+    layout.add (std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "OVERSAMPLE", 1 }, "Oversampling",
+                                                             juce::StringArray { "Off", "2x", "4x", "8x" }, 0));
+    
+    // IIR half-bands are cheap with little latency, linear phase costs more latency but no phase shift
+    layout.add (std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "OSLINEARPHASE", 1 }, "Linear Phase Oversampling", false));
+    
+    // Antiderivative anti-aliasing on the clippers, a lot cheaper than oversampling (and can be stacked with it)
+    layout.add (std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "ADAA", 1 }, "Anti-Aliasing",
+                                                             juce::StringArray { "Off", "1st Order", "2nd Order" }, 0));
+    
+    // Both clippers baked into one lookup table, cheapest of the lot (ignored while ADAA is on)
+    layout.add (std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "CLIPTABLE", 1 }, "Clipper Lookup Table", false));
+    
+    // Offline render profile, used when the host bounces (isNonRealtime) so exports get the best
+    // quality and live playback keeps the cheap settings above
+    layout.add (std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "RENDERHQ", 1 }, "High Quality Offline Render", true));
+    
+    layout.add (std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "RENDEROVERSAMPLE", 1 }, "Offline Render Oversampling",
+                                                             juce::StringArray { "Off", "2x", "4x", "8x" }, 3));
+    
+    // Adaptive quality: drops the anti-aliasing a notch at a time while this instance takes more
+    // than CPUBUDGET (percent of each block's deadline), and brings it back once there's headroom
+    layout.add (std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "ADAPTIVEQUALITY", 1 }, "Adaptive Quality", false));
+    
+    layout.add (std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "CPUBUDGET", 1 }, "CPU Budget",
+                                                            juce::NormalisableRange<float> (1.0f, 100.0f, 1.0f), 25.0f,
+                                                            juce::AudioParameterFloatAttributes().withLabel ("%")));
+    
+    // Cabinet IR after the post low-pass, the file itself is picked in the editor
+    layout.add (std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "CABINET", 1 }, "Cabinet IR", false));
+    
+    // Circuit = the wave digital model of the pedal (FuzzCircuit.h), same knobs, a few times the CPU.
+    // Switching fades through dry so the two engines never get mixed
+    layout.add (std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "ENGINE", 1 }, "Engine",
+                                                             juce::StringArray { "Classic", "Circuit" }, 0));
+    
+    // The host's bypass switch (1 = bypassed, the other way round from PEDALON). The two always
+    // follow each other, so a host's own bypass fades through the footswitch too. It goes last so
+    // nothing that was here before moves
+    layout.add (std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "BYPASS", 1 }, "Bypass", false));
+    
     return layout;
 }
 
@@ -87,9 +168,27 @@ bool FuzzColaAudioProcessor::isMidiEffect() const
 #endif
 }
 
+juce::AudioProcessorParameter* FuzzColaAudioProcessor::getBypassParameter() const
+{
+    return bypassParameter;
+}
+
+// The filters' real ring out plus the latency, hosts use this to stop calling
+// processBlock once the input has gone silent (the DSP goes idle by itself too)
 double FuzzColaAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return engine.getTailLengthSeconds();
+}
+
+// PEDALON and BYPASS are one switch, whichever moves (editor, MIDI, host automation or the
+// host's bypass button) drags the other along. Can come from the audio thread
+void FuzzColaAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    auto* other = parameterID == "BYPASS" ? pedalOnParameter : bypassParameter;
+    const bool otherOn = newValue < 0.5f;
+    
+    if (other != nullptr && (other->getValue() > 0.5f) != otherOn)
+        other->setValueNotifyingHost (otherOn ? 1.0f : 0.0f);
 }
 
 int FuzzColaAudioProcessor::getNumPrograms()
@@ -123,69 +222,16 @@ void FuzzColaAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     // initialisation that you need..
     currentSampleRate = sampleRate;
     
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = (juce::uint32) samplesPerBlock;
-    spec.numChannels = (juce::uint32) getTotalNumOutputChannels();
+    // both precisions get prepared, the host can switch between them without calling this again
+    engine.setOptions (readOptions());
+    engine.setParameters (readParameters());
+    engine.prepare (sampleRate, samplesPerBlock);
+    reportedLatency = -1;
     
-    for (std::size_t i = 0; i < chains.size(); ++i)
-    {
-        chains[i].prepare(spec);
-        
-        // Input booster / Sustain pre-gain
-        auto& inputGain = chains[i].get<InputGainIndex>();
-        inputGain.setRampDurationSeconds (0.001f);
-        
-        // Input high-pass
-        auto& preFilter = chains[i].get<PreHighPassIndex>();
-        preFilter.reset();
-        preFilter.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass (sampleRate, 30.0f);
-        
-        // Clipping stages
-        auto& clip1 = chains[i].get<Clipper1Index>();
-        auto& clip2 = chains[i].get<Clipper2Index>();
-        
-        // Both of the stages use tanh-based shaping functions
-        
-        // Stage 1: soft, pretty symmetric pre-shaping
-        clip1.functionToUse = [] (float x)
-        {
-            const float vClip = 0.9f; // vclip controls output amplitude
-            const float drive = 3.0f; // drive is amount of saturation basically
-            
-            const float y = drive * x / vClip; // scale input by drive and ampltiude
-            return vClip * std::tanh (y);
-        };
-        
-        // Stage 2: add even harmonics for warmth
-        // I realized that before I was only doing odd harmonics so I have to offset to also get some even ones
-        clip2.functionToUse = [] (float x)
-        {
-            const float vClip = 0.8f;
-            const float drive = 5.0f;
-            const float Offset  = 0.25f;   // controls asymmetry/offset
-            
-            // subtract tanh(drive * offset) to center around 0 since tanh is odd
-            const float yOffset = drive * (x + Offset);
-            const float center  = std::tanh (drive * Offset);
-            
-            const float shaped = std::tanh (yOffset) - center;
-            
-            return vClip * shaped;
-        };
-        
-        // Global post low-pass to smooth the very top fizz
-        // I added as i noticed that the real pedal doesnt have much high end above like 5.5 kHz
-        auto& postLowPass = chains[i].get<PostLowPassIndex>();
-        postLowPass.reset();
-        postLowPass.coefficients = juce::dsp::IIR::Coefficients<float>::makeFirstOrderLowPass (sampleRate, 5500.0f);
-        
-        // Output gain (Volume)
-        auto& outputGain = chains[i].get<OutputGainIndex>();
-        outputGain.setRampDurationSeconds(0.001f);
-    }
+    // the IR gets resampled to this in the background, the cabinet stays a straight wire till then
+    irLoader.setSampleRate (sampleRate);
     
-    updateDSPFromParameters();
+    updateLatency (engine.getLatencyInSamples());
     
 }
 
@@ -210,9 +256,13 @@ bool FuzzColaAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
         && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
     
-    // This checks if the input layout matches the output layout
+    // This checks if the input layout matches the output layout,
+    // apart from mono in / stereo out (a mono guitar DI on a stereo track)
 #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    const bool monoToStereo = layouts.getMainInputChannelSet() == juce::AudioChannelSet::mono()
+                           && layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo();
+    
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet() && ! monoToStereo)
         return false;
 #endif
     
@@ -221,85 +271,188 @@ bool FuzzColaAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 }
 #endif
 
-// Updates Parameters in the DSP from the APVTS
-void FuzzColaAudioProcessor::updateDSPFromParameters()
+// Snapshot of the APVTS values the DSP cares about
+FuzzColaParameters FuzzColaAudioProcessor::readParameters() const
 {
-    const float sustain = *apvts.getRawParameterValue ("SUSTAIN");
-    const float tone = *apvts.getRawParameterValue ("TONE");
-    const float volumeDb = *apvts.getRawParameterValue ("VOLUME");
-    const bool  toneBypass = (*apvts.getRawParameterValue ("TONEBYPASS") > 0.5f);
+    FuzzColaParameters parameters;
+    parameters.sustain = sustainParam->load (std::memory_order_relaxed);
+    parameters.tone = toneParam->load (std::memory_order_relaxed);
+    parameters.volumeDb = volumeParam->load (std::memory_order_relaxed);
+    parameters.toneEnabled = (toneBypassParam->load (std::memory_order_relaxed) > 0.5f);
+    parameters.oversamplingStages = (int) oversampleParam->load (std::memory_order_relaxed);
+    parameters.linearPhaseOversampling = (osLinearPhaseParam->load (std::memory_order_relaxed) > 0.5f);
+    parameters.adaaOrder = (int) adaaParam->load (std::memory_order_relaxed);
+    parameters.useClipTable = (clipTableParam->load (std::memory_order_relaxed) > 0.5f);
+    // off if either says so, for the moment before the listener has caught the other one up
+    parameters.pedalOn = (pedalOnParam->load (std::memory_order_relaxed) > 0.5f)
+                      && (bypassParam->load (std::memory_order_relaxed) < 0.5f);
+    parameters.circuitModel = ((int) engineParam->load (std::memory_order_relaxed) == 1);
+    return parameters;
+}
+
+// The render profile is on while the host renders offline (and RENDERHQ allows it),
+// adaptive quality only while it doesn't
+FuzzColaEngineOptions FuzzColaAudioProcessor::readOptions() const
+{
+    FuzzColaEngineOptions options;
+    options.offline = isNonRealtime();
+    options.highQualityOffline = (renderQualityParam->load (std::memory_order_relaxed) > 0.5f);
+    options.offlineOversamplingStages = (int) renderOversampleParam->load (std::memory_order_relaxed);
+    options.adaptiveQuality = (adaptiveQualityParam->load (std::memory_order_relaxed) > 0.5f);
+    options.cpuBudgetPercent = cpuBudgetParam->load (std::memory_order_relaxed);
+    return options;
+}
+
+// Only tells the host when it actually changed
+void FuzzColaAudioProcessor::updateLatency (int latencySamples)
+{
+    if (latencySamples != reportedLatency)
+    {
+        reportedLatency = latencySamples;
+        setLatencySamples (latencySamples);
+    }
+}
+
+// Same for both precisions, the engine picks its DSP by the buffer's type
+template <typename SampleType>
+void FuzzColaAudioProcessor::processWithEngine (juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages)
+{
+    engine.setOptions (readOptions());
     
-    // Gives the pedal some built-in dirt even at minimum
-    const float sustainDb = juce::jmap (sustain, 0.0f, 1.0f,
-                                        15.0f, 45.0f);
+    const int numSamples = buffer.getNumSamples();
+    const int numOutputChannels = juce::jmin (getTotalNumOutputChannels(), buffer.getNumChannels(), FuzzColaEngine::maxChannels);
+    const int numInputChannels = juce::jmin (getTotalNumInputChannels(), numOutputChannels);
     
-    // ye old processor chain
-    for (std::size_t i = 0; i < chains.size(); ++i)
+    // the footswitch (PEDALON) goes in with the rest, the engine fades to its latency matched dry signal
+    // (mono in, stereo out gets fanned out to both sides in there too)
+    auto processRange = [&] (int start, int end)
     {
-        juce::dsp::ProcessorChain<
+        SampleType* channels[FuzzColaEngine::maxChannels] = {};
         
-        juce::dsp::Gain<float>,
-        juce::dsp::IIR::Filter<float>,
-        juce::dsp::WaveShaper<float>,
-        juce::dsp::WaveShaper<float>,
-        ToneStack,
-        juce::dsp::IIR::Filter<float>,
-        juce::dsp::Gain<float>
+        for (int i = 0; i < numOutputChannels; ++i)
+            channels[i] = buffer.getWritePointer (i, start);
         
-        >& chain = chains[i];
+        engine.setParameters (readParameters());
+        engine.process (channels, numInputChannels, numOutputChannels, end - start);
+        updateLatency (engine.getLatencyInSamples());
+    };
+    
+    // MIDI CCs land on the sample they were sent at: the block gets split there and the
+    // parameter changes in between. Splits closer than minSubBlockSize to the previous one
+    // get pulled back to it, so a dense CC stream can't chop the block into tiny pieces
+    int position = 0;
+    
+    for (const auto metadata : midiMessages)
+    {
+        const auto message = metadata.getMessage();
         
-        juce::dsp::Gain<float>& inputGain  = chain.get<InputGainIndex>();
-        ToneStack&toneStage = chain.get<ToneStackIndex>();
-        juce::dsp::Gain<float>& outputGain = chain.get<OutputGainIndex>();
+        if (! message.isController())
+            continue;
         
-        inputGain.setGainDecibels(sustainDb);
-        outputGain.setGainDecibels(volumeDb);
+        const int eventPosition = juce::jlimit (0, numSamples, metadata.samplePosition);
         
-        const float effectiveTone = toneBypass ? tone : 0.5f;  // neutral-ish when bypassed
-        toneStage.setTone(effectiveTone);
+        if (eventPosition - position >= minSubBlockSize)
+        {
+            processRange (position, eventPosition);
+            position = eventPosition;
+        }
         
+        handleMidiController (message.getControllerNumber(), message.getControllerValue());
     }
+    
+    processRange (position, numSamples);
+    
+    for (int channel = numOutputChannels; channel < buffer.getNumChannels(); ++channel)
+        buffer.clear (channel, 0, numSamples);
 }
 
 // Process Block
+// (rendering offline the whole pedal runs in double, even for a float host)
 void FuzzColaAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    juce::ignoreUnused(midiMessages);
-    juce::ScopedNoDenormals noDenormals;
+    processWithEngine (buffer, midiMessages);
+}
+
+// 64 bit hosts land here, the whole pedal runs in double
+void FuzzColaAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processWithEngine (buffer, midiMessages);
+}
+
+//==============================================================================
+// MIDI learn
+const juce::StringArray& FuzzColaAudioProcessor::getMidiLearnableParameters()
+{
+    static const juce::StringArray ids { "PEDALON", "SUSTAIN", "TONE", "VOLUME", "TONEBYPASS" };
+    return ids;
+}
+
+// the next CC that comes in gets mapped to paramID
+void FuzzColaAudioProcessor::startMidiLearn (const juce::String& paramID)
+{
+    midiLearnTarget = getMidiLearnableParameters().indexOf (paramID);
+}
+
+bool FuzzColaAudioProcessor::isMidiLearning (const juce::String& paramID) const
+{
+    const int target = midiLearnTarget.load();
+    return target >= 0 && target == getMidiLearnableParameters().indexOf (paramID);
+}
+
+void FuzzColaAudioProcessor::setMidiMapping (const juce::String& paramID, int controller)
+{
+    const int index = getMidiLearnableParameters().indexOf (paramID);
     
-    const int totalNumInputChannels = getTotalNumInputChannels();
-    const int totalNumOutputChannels = getTotalNumOutputChannels();
+    if (index >= 0)
+        setMidiMappingIndex (index, controller);
+}
+
+// by index into getMidiLearnableParameters(), so learning on the audio thread needs no strings
+void FuzzColaAudioProcessor::setMidiMappingIndex (int index, int controller)
+{
+    // one CC per parameter
+    for (auto& mapping : midiMappings)
+    {
+        int expected = index;
+        mapping.compare_exchange_strong (expected, -1);
+    }
     
-    for (int channel = totalNumInputChannels; channel < totalNumOutputChannels; ++channel)
-        buffer.clear(channel, 0, buffer.getNumSamples());
+    if (juce::isPositiveAndBelow (controller, (int) midiMappings.size()))
+        midiMappings[(size_t) controller] = index;
+}
+
+int FuzzColaAudioProcessor::getMidiMapping (const juce::String& paramID) const
+{
+    const int index = getMidiLearnableParameters().indexOf (paramID);
     
-    // Footswitch -> hard bypass of whole pedal
-    const bool pedalOn = (*apvts.getRawParameterValue ("PEDALON") > 0.5f);
+    for (size_t cc = 0; cc < midiMappings.size(); ++cc)
+        if (index >= 0 && midiMappings[cc].load() == index)
+            return (int) cc;
     
-    if (! pedalOn)
-        return; // passthrough (input already in buffer)
+    return -1;
+}
+
+// Audio thread: learns if it's listening, then moves whatever the CC is mapped to
+// (switches are on from 64 up, knobs get the full 0..127 across their range)
+void FuzzColaAudioProcessor::handleMidiController (int controller, int value)
+{
+    const int learning = midiLearnTarget.exchange (-1);
     
-    updateDSPFromParameters();
+    if (learning >= 0)
+        setMidiMappingIndex (learning, controller);
     
-    juce::dsp::AudioBlock<float> block (buffer);
+    const int index = midiMappings[(size_t) juce::jlimit (0, 127, controller)].load();
     
-    // if mono, process single channel
-    if (buffer.getNumChannels() == 1)
-    {
-        juce::dsp::ProcessContextReplacing<float> monoContext (block);
-        chains[0].process(monoContext);
-    }
-    // otherwise process stereo
-    else
+    if (! juce::isPositiveAndBelow (index, numMidiLearnableParameters))
+        return;
+    
+    if (auto* param = midiLearnableParams[(size_t) index])
     {
-        juce::dsp::AudioBlock<float> leftBlock = block.getSingleChannelBlock (0);
-        juce::dsp::AudioBlock<float> rightBlock = block.getSingleChannelBlock (1);
-        
-        juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-        juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+        const float normalised = param->isBoolean() ? param->convertTo0to1 (value >= 64 ? 1.0f : 0.0f)
+                                                    : (float) value / 127.0f;
         
-        chains[0].process(leftContext);
-        chains[1].process(rightContext);
+        if (normalised != param->getValue())
+            param->setValueNotifyingHost (normalised);
     }
 }
 
@@ -322,6 +475,15 @@ void FuzzColaAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     juce::ValueTree state = apvts.copyState();
+    
+    // MIDI mappings go with the session, not with presets
+    juce::ValueTree midiMap ("MIDIMAP");
+    
+    for (const auto& paramID : getMidiLearnableParameters())
+        midiMap.setProperty (paramID, getMidiMapping (paramID), nullptr);
+    
+    state.appendChild (midiMap, nullptr);
+    
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
     copyXmlToBinary(*xml, destData);
 }
@@ -336,15 +498,27 @@ void FuzzColaAudioProcessor::setStateInformation (const void* data, int sizeInBy
     if (xmlState != nullptr && xmlState->hasTagName (apvts.state.getType()))
     {
         juce::ValueTree state = juce::ValueTree::fromXml (*xmlState);
+        
+        // sessions from before MIDI learn keep the default footswitch CC
+        const juce::ValueTree midiMap = state.getChildWithName ("MIDIMAP");
+        
+        if (midiMap.isValid())
+        {
+            for (const auto& paramID : getMidiLearnableParameters())
+                setMidiMapping (paramID, midiMap.getProperty (paramID, -1));
+            
+            state.removeChild (midiMap, nullptr);
+        }
+        
         apvts.replaceState (state);
+        updateImpulseResponseFile();
     }
 }
 
 // load presets from folder
 juce::File FuzzColaAudioProcessor::getPresetFolder() const
 {
-    return juce::File::getSpecialLocation
-    (juce::File::userApplicationDataDirectory).getChildFile("SilverDSP").getChildFile("FuzzCola").getChildFile("Presets");
+    return FuzzColaPresets::getUserPresetFolder();
 }
 
 // save preset to file
@@ -371,7 +545,30 @@ void FuzzColaAudioProcessor::loadPresetFromFile (const juce::File& file)
     if (xml == nullptr) return;
     
     if (xml->hasTagName(apvts.state.getType()))
+    {
         apvts.replaceState(juce::ValueTree::fromXml (*xml));
+        updateImpulseResponseFile();
+    }
+}
+
+// Cabinet IR file, kept as a property of the state
+void FuzzColaAudioProcessor::loadImpulseResponse (const juce::File& file)
+{
+    apvts.state.setProperty ("IRFILE", file.getFullPathName(), nullptr);
+    updateImpulseResponseFile();
+}
+
+void FuzzColaAudioProcessor::clearImpulseResponse()
+{
+    apvts.state.removeProperty ("IRFILE", nullptr);
+    updateImpulseResponseFile();
+}
+
+// after the state changes, a missing or junk IRFILE means no IR
+void FuzzColaAudioProcessor::updateImpulseResponseFile()
+{
+    const juce::String path = apvts.state.getProperty ("IRFILE").toString();
+    irLoader.setFile (juce::File::isAbsolutePath (path) ? juce::File (path) : juce::File());
 }
 
 // sets parameter value
@@ -391,20 +588,11 @@ void FuzzColaAudioProcessor::setParamBool (const juce::String& paramID, bool b)
     setParamValue(paramID, b ? 1.0f : 0.0f);
 }
 
-// factory presets
-void FuzzColaAudioProcessor::buildFactoryPresets()
-{
-    factoryPresets.clear();
-    
-    factoryPresets.add({ "Wall Of Sound", 0.90f, 0.42f,  0.0f, true, true });
-    factoryPresets.add({ "Scooped Rhythm", 0.72f, 0.30f, -3.0f, true, true });
-    factoryPresets.add({ "Tight Lead", 0.60f, 0.65f, +2.0f, true, true });
-    factoryPresets.add({ "Tone Bypass Hit", 0.85f, 0.50f,  0.0f, false,  true  });
-}
-
 // actually apply factory preset by index
 void FuzzColaAudioProcessor::applyFactoryPreset (int index)
 {
+    const auto& factoryPresets = getFactoryPresets();
+    
     if (! juce::isPositiveAndBelow (index, factoryPresets.size()))
         return;
     
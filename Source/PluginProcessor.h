@@ -8,11 +8,14 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include "FuzzColaEngine.h"
+#include "FuzzColaPresets.h"
 
 //==============================================================================
 /**
  */
-class FuzzColaAudioProcessor  : public juce::AudioProcessor
+class FuzzColaAudioProcessor  : public juce::AudioProcessor,
+                                private juce::AudioProcessorValueTreeState::Listener
 {
     public:
     //==============================================================================
@@ -28,6 +31,8 @@ class FuzzColaAudioProcessor  : public juce::AudioProcessor
 #endif
     
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
     
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -41,6 +46,9 @@ class FuzzColaAudioProcessor  : public juce::AudioProcessor
     bool isMidiEffect() const override;
     double getTailLengthSeconds() const override;
     
+    // BYPASS, kept in step with PEDALON so a host's own bypass fades through the footswitch too
+    juce::AudioProcessorParameter* getBypassParameter() const override;
+    
     //==============================================================================
     int getNumPrograms() override;
     int getCurrentProgram() override;
@@ -57,17 +65,10 @@ class FuzzColaAudioProcessor  : public juce::AudioProcessor
     
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     
-    struct FactoryPreset
-    {
-        juce::String name;
-        float sustain = 0.5f;
-        float tone = 0.5f;
-        float volumeDb = 0.8f;
-        bool toneEnabled = true;
-        bool pedalOn = true;
-    };
+    // the table lives in FuzzColaPresets.h, the batch renderer reads the same one
+    using FactoryPreset = FuzzColaFactoryPreset;
     
-    const juce::Array<FactoryPreset>& getFactoryPresets() const { return factoryPresets; }
+    const juce::Array<FactoryPreset>& getFactoryPresets() const { return FuzzColaPresets::getFactoryPresets(); }
     
     void applyFactoryPreset (int index);
     
@@ -75,122 +76,102 @@ class FuzzColaAudioProcessor  : public juce::AudioProcessor
     void savePresetToFile(juce::File file);
     void loadPresetFromFile(const juce::File& file);
     
+    // MIDI learn for the footswitch and knobs, a CC on a switch is on from 64 up,
+    // on a knob 0..127 covers its whole range
+    static const juce::StringArray& getMidiLearnableParameters();
+    void startMidiLearn (const juce::String& paramID);
+    bool isMidiLearning (const juce::String& paramID) const;
+    void setMidiMapping (const juce::String& paramID, int controller);   // -1 clears it
+    int getMidiMapping (const juce::String& paramID) const;              // -1 if not mapped
+    
+    // Adaptive quality tier running right now, 0 = the anti-aliasing as set, every step up is a
+    // notch cheaper (see FuzzColaDsp::applyQualityTier). Fine to poll from the editor
+    int getQualityTier() const noexcept { return engine.getQualityTier(); }
+    
+    // Cabinet IR, switched by CABINET. The file goes in the state as IRFILE (so sessions and
+    // presets both keep it), the loading happens in the background
+    void loadImpulseResponse (const juce::File& file);
+    void clearImpulseResponse();
+    juce::File getImpulseResponseFile() const { return irLoader.getFile(); }
+    juce::String getImpulseResponseName() const { return irLoader.getLoadedName(); }        // empty until it's loaded
+    bool impulseResponseFailedToLoad() const { return irLoader.failedToLoad(); }
+    
+    // Stage by stage through the ProcessorChain instead of the fused loops (same result, slower)
+    // handy for checking the fused path against the original
+    void setUseReferenceChain (bool shouldUseReference) noexcept { engine.setUseReferenceChain (shouldUseReference); }
+    
     private:
     
     // Factory presets
-    juce::Array<FactoryPreset> factoryPresets;
-    void buildFactoryPresets();
     void setParamValue(const juce::String& paramID, float actualValue);
     void setParamBool(const juce::String& paramID, bool b);
     
     
-    // DSP tone stack approximation
-    struct ToneStack
-    {
-        ToneStack() = default;
-        
-        // Prepare the filters
-        void prepare(const juce::dsp::ProcessSpec& spec)
-        {
-            sampleRate = spec.sampleRate;
-            
-            lowShelf.reset();
-            highShelf.reset();
-            
-            updateFilters();
-        }
-        
-        // Reset filters so no clicks
-        void reset()
-        {
-            lowShelf.reset();
-            highShelf.reset();
-        }
-        
-        // tone = 0 .. 1  (0 = dark, 1 = bright)
-        // Default = 0.5
-        void setTone(float newTone)
-        {
-            tone = juce::jlimit (0.0f, 1.0f, newTone);
-            updateFilters();
-        }
-        
-        // Process audio block
-        template <typename ProcessContext>
-        void process(const ProcessContext& context)
-        {
-            // shelves in series
-            lowShelf.process(context);
-            highShelf.process(context);
-        }
-        
-        private:
-        // Update filter coefficients based on tone setting
-        void updateFilters()
-        {
-            // Filter parameters
-            // These corner frequencies were chosen to roughly approximate (both via electrosmash but also by ear)
-            const float lpCutHz = 450.0f;   // bass / low-mid shelf corner
-            const float hpCutHz = 1500.0f;  // upper-mid / treble shelf corner
-            const float q = 0.7071f;
-            
-            // tone = 0 -> +3.5 dB bass, -5 dB treble (dark & fat)
-            // tone = 0.5 -> +0.5 dB bass, +1.5 dB treble (slightly warm)
-            // tone = 1 -> -2.5 dB bass, +8 dB treble (bright)
-            const float bassGainDb = juce::jmap(tone,  3.5f, -2.5f);
-            const float trebleGainDb = juce::jmap(tone, -5.0f,  8.0f);
-            
-            // Convert dB gains to linear
-            const float bassGainLinear = juce::Decibels::decibelsToGain(bassGainDb);
-            const float trebleGainLinear = juce::Decibels::decibelsToGain(trebleGainDb);
-            
-            // Update filter coefficients
-            lowShelf.coefficients = juce::dsp::IIR::Coefficients<float>::makeLowShelf(sampleRate, lpCutHz, q, bassGainLinear);
-            highShelf.coefficients = juce::dsp::IIR::Coefficients<float>::makeHighShelf(sampleRate, hpCutHz, q, trebleGainLinear);
-        }
-        
-        // Defaults
-        double sampleRate = 44100.0;
-        float tone = 0.5f;
-        
-        juce::dsp::IIR::Filter<float> lowShelf;
-        juce::dsp::IIR::Filter<float> highShelf;
-    };
-    
-    
-    // its always much easier to keep track of chain if enum
-    enum ChainPositions
-    {
-        InputGainIndex = 0,  // pre-gain / Sustain
-        PreHighPassIndex = 1,  // input HPF
-        Clipper1Index = 2,  // clipping stage 1
-        Clipper2Index = 3,  // clipping stage 2
-        ToneStackIndex = 4,  // HP/LP blend tone stack
-        PostLowPassIndex = 5,  // final fizz killer, when listening to original pedal i realized it needs a way to get rid of extra fizz
-        OutputGainIndex = 6   // Volume
-    };
-    
-    // 2 mono chains (L/R)
-    std::array<
-    juce::dsp::ProcessorChain<
-    juce::dsp::Gain<float>,          // InputGainIndex
-    juce::dsp::IIR::Filter<float>,   // PreHighPassIndex
-    juce::dsp::WaveShaper<float>,    // Clipper1Index
-    juce::dsp::WaveShaper<float>,    // Clipper2Index
-    ToneStack,                       // ToneStackIndex
-    juce::dsp::IIR::Filter<float>,   // PostLowPassIndex
-    juce::dsp::Gain<float>           // OutputGainIndex
-    >,
-    2 // stereo channels
-    > chains;
-    
-    
     double currentSampleRate = 44100.0;
     
+    // The whole signal path (FuzzColaEngine.h), this only feeds it the APVTS and the host's blocks
+    FuzzColaEngine engine;
+    int reportedLatency = 0;
+    
     // StateTree
     juce::AudioProcessorValueTreeState apvts;
     
-    void updateDSPFromParameters();
+    // Parameter pointers looked up once, so the audio thread never does string lookups
+    std::atomic<float>* sustainParam = nullptr;
+    std::atomic<float>* toneParam = nullptr;
+    std::atomic<float>* volumeParam = nullptr;
+    std::atomic<float>* pedalOnParam = nullptr;
+    std::atomic<float>* toneBypassParam = nullptr;
+    std::atomic<float>* oversampleParam = nullptr;
+    std::atomic<float>* osLinearPhaseParam = nullptr;
+    std::atomic<float>* adaaParam = nullptr;
+    std::atomic<float>* clipTableParam = nullptr;
+    std::atomic<float>* renderQualityParam = nullptr;
+    std::atomic<float>* renderOversampleParam = nullptr;
+    std::atomic<float>* adaptiveQualityParam = nullptr;
+    std::atomic<float>* cpuBudgetParam = nullptr;
+    std::atomic<float>* cabinetParam = nullptr;
+    std::atomic<float>* engineParam = nullptr;
+    std::atomic<float>* bypassParam = nullptr;
+    
+    // the footswitch and the host's bypass, for keeping the two in step
+    juce::RangedAudioParameter* pedalOnParameter = nullptr;
+    juce::RangedAudioParameter* bypassParameter = nullptr;
+    
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    
+    // after the engine and the APVTS, it calls into both from its thread until it's gone
+    ImpulseResponseLoader irLoader;
+    
+    void updateImpulseResponseFile();
+    
+    // Offline render profile and adaptive quality, checked every block since
+    // hosts can flip isNonRealtime() without preparing again
+    FuzzColaEngineOptions readOptions() const;
+    
+    FuzzColaParameters readParameters() const;
+    void updateLatency (int latencySamples);
+    
+    template <typename SampleType>
+    void processWithEngine (juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages);
+    
+    // Blocks get split at MIDI CCs, but never into pieces shorter than this
+    static constexpr int minSubBlockSize = 32;
+    
+    // CC number -> index into getMidiLearnableParameters(), -1 = not mapped
+    // (atomics since the audio thread reads them and learns into them)
+    std::array<std::atomic<int>, 128> midiMappings;
+    std::atomic<int> midiLearnTarget { -1 };
+    
+    // getMidiLearnableParameters() looked up once, same order, for the audio thread
+    static constexpr int numMidiLearnableParameters = 5;
+    std::array<juce::RangedAudioParameter*, numMidiLearnableParameters> midiLearnableParams {};
+    
+    // CC 64 (sustain pedal) is what most single foot switches send out of the box
+    static constexpr int defaultFootswitchController = 64;
+    
+    void handleMidiController (int controller, int value);
+    void setMidiMappingIndex (int index, int controller);
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FuzzColaAudioProcessor)
 };
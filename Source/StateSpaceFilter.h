@@ -0,0 +1,308 @@
+/*
+ ==============================================================================
+
+ StateSpaceFilter.h
+ Linear filter cascades as one state-space system, run a block of samples at a time.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <type_traits>
+#include "DspKernels.h"
+#include "TptFilters.h"
+
+// x[n+1] = A x[n] + B u[n],  y[n] = C x[n] + D u[n]
+// Worked out in double, the block matrices get cast down once they're built
+template <int order>
+struct LinearSystem
+{
+    std::array<std::array<double, order>, order> A {};
+    std::array<double, order> B {};
+    std::array<double, order> C {};
+    double D = 0.0;
+};
+
+namespace StateSpace
+{
+    // The TPT structures written out as matrices, with their own integrator states as the state
+    // vector, so a state-space run can hand its state straight back to the filter objects
+    template <typename SampleType>
+    LinearSystem<2> fromSvf (const SvfCoefficients<SampleType>& c)
+    {
+        const double a1 = c.a1, a2 = c.a2, a3 = c.a3;
+        const double m0 = c.m0, m1 = c.m1, m2 = c.m2;
+
+        LinearSystem<2> s;
+        s.A = {{ { 2.0 * a1 - 1.0, -2.0 * a2 }, { 2.0 * a2, 1.0 - 2.0 * a3 } }};
+        s.B = { 2.0 * a2, 2.0 * a3 };
+        s.C = { m1 * a1 + m2 * a2, m2 * (1.0 - a3) - m1 * a2 };
+        s.D = m0 + m1 * a2 + m2 * a3;
+        return s;
+    }
+
+    inline LinearSystem<1> fromOnePole (double G)
+    {
+        LinearSystem<1> s;
+        s.A = {{ { 1.0 - 2.0 * G } }};
+        s.B = { 2.0 * G };
+        s.C = { 1.0 - G };
+        s.D = G;
+        return s;
+    }
+
+    // Largest pole radius, i.e. how much the slowest part of the free response shrinks per sample
+    inline double poleRadius (const LinearSystem<1>& s)
+    {
+        return std::abs (s.A[0][0]);
+    }
+
+    inline double poleRadius (const LinearSystem<2>& s)
+    {
+        const double halfTrace = 0.5 * (s.A[0][0] + s.A[1][1]);
+        const double det = s.A[0][0] * s.A[1][1] - s.A[0][1] * s.A[1][0];
+        const double discriminant = halfTrace * halfTrace - det;
+
+        // complex pair, both the same distance out
+        if (discriminant < 0.0)
+            return std::sqrt (det);
+
+        const double root = std::sqrt (discriminant);
+        return std::max (std::abs (halfTrace + root), std::abs (halfTrace - root));
+    }
+
+    // first feeds second, the state is first's states followed by second's
+    template <int n1, int n2>
+    LinearSystem<n1 + n2> series (const LinearSystem<n1>& first, const LinearSystem<n2>& second)
+    {
+        LinearSystem<n1 + n2> s;
+
+        for (int r = 0; r < n1; ++r)
+        {
+            for (int c = 0; c < n1; ++c)
+                s.A[(size_t) r][(size_t) c] = first.A[(size_t) r][(size_t) c];
+
+            s.B[(size_t) r] = first.B[(size_t) r];
+            s.C[(size_t) r] = second.D * first.C[(size_t) r];
+        }
+
+        for (int r = 0; r < n2; ++r)
+        {
+            for (int c = 0; c < n1; ++c)
+                s.A[(size_t) (n1 + r)][(size_t) c] = second.B[(size_t) r] * first.C[(size_t) c];
+
+            for (int c = 0; c < n2; ++c)
+                s.A[(size_t) (n1 + r)][(size_t) (n1 + c)] = second.A[(size_t) r][(size_t) c];
+
+            s.B[(size_t) (n1 + r)] = second.B[(size_t) r] * first.D;
+            s.C[(size_t) (n1 + r)] = second.C[(size_t) r];
+        }
+
+        s.D = second.D * first.D;
+        return s;
+    }
+}
+
+// Runs a LinearSystem blockSize samples at a time:
+//   y[k]       = C A^k x + sum over j <= k of h[k - j] u[j]   (h = impulse response)
+//   x[next]    = A^blockSize x + sum over j of A^(blockSize - 1 - j) B u[j]
+// so every output of a block only depends on the state at the start of it, and each
+// matrix column turns into one multiply-add across the whole block instead of a chain
+// of dependent per-sample updates. The inner loops are fixed length so they vectorise.
+// Leftover samples at the end go through the one sample recursion.
+// The state lives with the caller, so it can be swapped with the filters it came from.
+template <typename SampleType, int order, int blockSize = 16>
+class BlockStateSpace
+{
+    public:
+    using State = std::array<SampleType, order>;
+
+    void setSystem (const LinearSystem<order>& system)
+    {
+        // A^k for k = 0 .. blockSize
+        std::array<std::array<std::array<double, order>, order>, blockSize + 1> powers {};
+
+        for (int r = 0; r < order; ++r)
+            powers[0][(size_t) r][(size_t) r] = 1.0;
+
+        for (int k = 1; k <= blockSize; ++k)
+            powers[(size_t) k] = multiply (powers[(size_t) k - 1], system.A);
+
+        // C A^k, the free response of the block
+        for (int k = 0; k < blockSize; ++k)
+            for (int s = 0; s < order; ++s)
+            {
+                double sum = 0.0;
+
+                for (int r = 0; r < order; ++r)
+                    sum += system.C[(size_t) r] * powers[(size_t) k][(size_t) r][(size_t) s];
+
+                freeResponse[(size_t) s][(size_t) k] = (SampleType) sum;
+            }
+
+        // h[0] = D, h[m] = C A^(m - 1) B
+        std::array<double, blockSize> impulse {};
+        impulse[0] = system.D;
+
+        for (int m = 1; m < blockSize; ++m)
+            impulse[(size_t) m] = dot (system.C, apply (powers[(size_t) m - 1], system.B));
+
+        for (int j = 0; j < blockSize; ++j)
+            for (int k = 0; k < blockSize; ++k)
+                forcedResponse[(size_t) j][(size_t) k] = k >= j ? (SampleType) impulse[(size_t) (k - j)] : SampleType (0);
+
+        // state after the block
+        for (int s = 0; s < order; ++s)
+            for (int r = 0; r < order; ++r)
+                stateTransition[(size_t) s][(size_t) r] = (SampleType) powers[(size_t) blockSize][(size_t) r][(size_t) s];
+
+        for (int j = 0; j < blockSize; ++j)
+        {
+            const auto column = apply (powers[(size_t) (blockSize - 1 - j)], system.B);
+
+            for (int r = 0; r < order; ++r)
+                stateInput[(size_t) j][(size_t) r] = (SampleType) column[(size_t) r];
+        }
+
+        // and the plain recursion for the tail
+        for (int r = 0; r < order; ++r)
+        {
+            for (int c = 0; c < order; ++c)
+                A[(size_t) c][(size_t) r] = (SampleType) system.A[(size_t) r][(size_t) c];
+
+            B[(size_t) r] = (SampleType) system.B[(size_t) r];
+            C[(size_t) r] = (SampleType) system.C[(size_t) r];
+        }
+
+        D = (SampleType) system.D;
+    }
+
+    // in place, output scaled by gain
+    void process (SampleType* data, int numSamples, State& state, SampleType gain) const noexcept
+    {
+        State x = state;
+        int i = 0;
+
+        // float runs the whole blocks through the SIMD kernels, so the loop below is left with none
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            static_assert (order <= DspKernels::maxStateSpaceOrder && blockSize <= DspKernels::maxStateSpaceBlockSize);
+
+            const DspKernels::StateSpaceMatrices matrices { order, blockSize, freeResponse[0].data(), forcedResponse[0].data(),
+                                                            stateTransition[0].data(), stateInput[0].data() };
+            const int numBlocks = numSamples / blockSize;
+
+            DspKernels::get().stateSpaceBlocks (data, numBlocks, x.data(), matrices, gain);
+            i = numBlocks * blockSize;
+        }
+
+        for (; i + blockSize <= numSamples; i += blockSize)
+        {
+            SampleType* u = data + i;
+
+            std::array<SampleType, blockSize> y {};
+            State next {};
+
+            for (int s = 0; s < order; ++s)
+            {
+                const SampleType xs = x[(size_t) s];
+
+                for (int k = 0; k < blockSize; ++k)
+                    y[(size_t) k] += freeResponse[(size_t) s][(size_t) k] * xs;
+
+                for (int r = 0; r < order; ++r)
+                    next[(size_t) r] += stateTransition[(size_t) s][(size_t) r] * xs;
+            }
+
+            for (int j = 0; j < blockSize; ++j)
+            {
+                const SampleType uj = u[j];
+
+                for (int k = 0; k < blockSize; ++k)
+                    y[(size_t) k] += forcedResponse[(size_t) j][(size_t) k] * uj;
+
+                for (int r = 0; r < order; ++r)
+                    next[(size_t) r] += stateInput[(size_t) j][(size_t) r] * uj;
+            }
+
+            for (int k = 0; k < blockSize; ++k)
+                u[k] = gain * y[(size_t) k];
+
+            x = next;
+        }
+
+        for (; i < numSamples; ++i)
+        {
+            const SampleType u = data[i];
+            SampleType y = D * u;
+            State next {};
+
+            for (int s = 0; s < order; ++s)
+            {
+                const SampleType xs = x[(size_t) s];
+                y += C[(size_t) s] * xs;
+
+                for (int r = 0; r < order; ++r)
+                    next[(size_t) r] += A[(size_t) s][(size_t) r] * xs;
+            }
+
+            for (int r = 0; r < order; ++r)
+                next[(size_t) r] += B[(size_t) r] * u;
+
+            data[i] = gain * y;
+            x = next;
+        }
+
+        state = x;
+    }
+
+    private:
+    using Matrix = std::array<std::array<double, order>, order>;
+
+    static Matrix multiply (const Matrix& a, const Matrix& b)
+    {
+        Matrix m {};
+
+        for (int r = 0; r < order; ++r)
+            for (int c = 0; c < order; ++c)
+                for (int k = 0; k < order; ++k)
+                    m[(size_t) r][(size_t) c] += a[(size_t) r][(size_t) k] * b[(size_t) k][(size_t) c];
+
+        return m;
+    }
+
+    static std::array<double, order> apply (const Matrix& m, const std::array<double, order>& v)
+    {
+        std::array<double, order> out {};
+
+        for (int r = 0; r < order; ++r)
+            for (int c = 0; c < order; ++c)
+                out[(size_t) r] += m[(size_t) r][(size_t) c] * v[(size_t) c];
+
+        return out;
+    }
+
+    static double dot (const std::array<double, order>& a, const std::array<double, order>& b)
+    {
+        double sum = 0.0;
+
+        for (int r = 0; r < order; ++r)
+            sum += a[(size_t) r] * b[(size_t) r];
+
+        return sum;
+    }
+
+    // all stored column by column (indexed [input][output]) so the inner loops run over contiguous memory
+    std::array<std::array<SampleType, blockSize>, order> freeResponse {};
+    std::array<std::array<SampleType, blockSize>, blockSize> forcedResponse {};
+    std::array<std::array<SampleType, order>, order> stateTransition {};
+    std::array<std::array<SampleType, order>, blockSize> stateInput {};
+
+    std::array<std::array<SampleType, order>, order> A {};
+    std::array<SampleType, order> B {}, C {};
+    SampleType D = 0;
+};
@@ -0,0 +1,183 @@
+/*
+ ==============================================================================
+
+ ToneStack.h
+ Tone stack approximation: low shelf + high shelf driven by one TONE knob.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include <juce_dsp/juce_dsp.h>
+#include "TptFilters.h"
+
+// DSP tone stack approximation
+// The shelves for every 0.01 step of the TONE knob are worked out once in prepare(),
+// moving the knob then just reads and blends two table entries instead of pow/tan,
+// The shelves are trapezoidal SVFs, so while the knob glides the coefficients get
+// updated every sample with no zipper noise and none of the blow ups a direct form biquad
+// can have when its coefficients move under it
+template <typename SampleType = float>
+struct ToneStack
+{
+    ToneStack() = default;
+
+    static constexpr int tableSize = 101;      // one entry per TONE parameter step
+
+    // Prepare the filters
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+
+        buildTable();
+
+        smoothedTone.reset (sampleRate, 0.03);
+        smoothedTone.setCurrentAndTargetValue (tone);
+        applyTone (tone);
+
+        lowShelf.reset();
+        highShelf.reset();
+    }
+
+    // Reset filters so no clicks
+    void reset()
+    {
+        smoothedTone.setCurrentAndTargetValue (tone);
+        applyTone (tone);
+
+        lowShelf.reset();
+        highShelf.reset();
+    }
+
+    // tone = 0 .. 1  (0 = dark, 1 = bright)
+    // Default = 0.5
+    // just sets where the glide is heading, process() does the rest
+    void setTone(SampleType newTone)
+    {
+        newTone = juce::jlimit (SampleType (0), SampleType (1), newTone);
+
+        if (newTone == tone)
+            return;
+
+        tone = newTone;
+        smoothedTone.setTargetValue (tone);
+    }
+
+    // Process audio block
+    template <typename ProcessContext>
+    void process(const ProcessContext& context)
+    {
+        // knob at rest: coefficients are already where they need to be
+        if (! smoothedTone.isSmoothing())
+        {
+            // shelves in series
+            lowShelf.process(context);
+            highShelf.process(context);
+            return;
+        }
+
+        auto&& outputBlock = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom (context.getInputBlock());
+
+        // mono, one tone stack per chain (the filters only hold one channel of state)
+        jassert (outputBlock.getNumChannels() == 1);
+
+        const int numSamples = (int) outputBlock.getNumSamples();
+        SampleType* data = outputBlock.getChannelPointer (0);
+
+        if (context.isBypassed)
+        {
+            smoothedTone.skip (numSamples);
+            applyTone (smoothedTone.getCurrentValue());
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            data[i] = processSample (data[i]);
+    }
+
+    // one sample, gliding the shelves along if the knob is moving
+    // (only two table reads and a blend, and the filters are left parked where the glide got to)
+    SampleType processSample (SampleType x) noexcept
+    {
+        if (smoothedTone.isSmoothing())
+            applyTone (smoothedTone.getNextValue());
+
+        return highShelf.processSample (lowShelf.processSample (x));
+    }
+
+    bool isGliding() const noexcept { return smoothedTone.isSmoothing(); }
+
+    // the shelves themselves, for loops that run them alongside other stages while the knob is at rest
+    TptSvf<SampleType>& getLowShelf() noexcept { return lowShelf; }
+    TptSvf<SampleType>& getHighShelf() noexcept { return highShelf; }
+
+    private:
+    using Coefficients = SvfCoefficients<SampleType>;
+
+    struct ShelfPair
+    {
+        Coefficients low {};
+        Coefficients high {};
+    };
+
+    // Work out the shelves for every tone step at this sample rate
+    void buildTable()
+    {
+        // Filter parameters
+        // These corner frequencies were chosen to roughly approximate (both via electrosmash but also by ear)
+        const double lpCutHz = 450.0;   // bass / low-mid shelf corner
+        const double hpCutHz = 1500.0;  // upper-mid / treble shelf corner
+        const double q = 0.7071;
+
+        for (int i = 0; i < tableSize; ++i)
+        {
+            const SampleType t = (SampleType) i / (SampleType) (tableSize - 1);
+
+            // tone = 0 -> +3.5 dB bass, -5 dB treble (dark & fat)
+            // tone = 0.5 -> +0.5 dB bass, +1.5 dB treble (slightly warm)
+            // tone = 1 -> -2.5 dB bass, +8 dB treble (bright)
+            const SampleType bassGainDb = juce::jmap(t, SampleType (3.5), SampleType (-2.5));
+            const SampleType trebleGainDb = juce::jmap(t, SampleType (-5.0), SampleType (8.0));
+
+            // Convert dB gains to linear
+            const SampleType bassGainLinear = juce::Decibels::decibelsToGain(bassGainDb);
+            const SampleType trebleGainLinear = juce::Decibels::decibelsToGain(trebleGainDb);
+
+            table[(size_t) i].low = Coefficients::makeLowShelf(sampleRate, lpCutHz, q, bassGainLinear);
+            table[(size_t) i].high = Coefficients::makeHighShelf(sampleRate, hpCutHz, q, trebleGainLinear);
+        }
+    }
+
+    // Blend the two nearest table entries
+    ShelfPair lookup (SampleType t) const
+    {
+        const SampleType position = juce::jlimit (SampleType (0), SampleType (1), t) * (SampleType) (tableSize - 1);
+        const int index = juce::jmin ((int) position, tableSize - 2);
+        const SampleType frac = position - (SampleType) index;
+
+        const auto& a = table[(size_t) index];
+        const auto& b = table[(size_t) index + 1];
+
+        return { Coefficients::interpolate (a.low, b.low, frac), Coefficients::interpolate (a.high, b.high, frac) };
+    }
+
+    void applyTone (SampleType t)
+    {
+        const auto pair = lookup (t);
+        lowShelf.setCoefficients (pair.low);
+        highShelf.setCoefficients (pair.high);
+    }
+
+    // Defaults
+    double sampleRate = 44100.0;
+    SampleType tone = SampleType (0.5);
+
+    juce::SmoothedValue<SampleType> smoothedTone { SampleType (0.5) };
+    std::array<ShelfPair, tableSize> table {};
+
+    TptSvf<SampleType> lowShelf;
+    TptSvf<SampleType> highShelf;
+};
@@ -0,0 +1,251 @@
+/*
+ ==============================================================================
+
+ TptFilters.h
+ Topology preserving transform (trapezoidal) filters: state variable + one-pole.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Coefficients for the trapezoidal SVF (Andrew Simper's "linear trap optimised 2" form)
+// Output is a mix of input, band-pass and low-pass, so one structure covers
+// high-pass, low-pass and both shelves. Unlike direct form biquads these stay
+// well behaved when blended or changed every sample, and keep their precision
+// for low corners at high sample rates even in float
+template <typename SampleType>
+struct SvfCoefficients
+{
+    SampleType a1 = 1, a2 = 0, a3 = 0;   // structure, from g and k
+    SampleType m0 = 1, m1 = 0, m2 = 0;   // output mix: x, band, low
+
+    // 2nd order, Q = 0.7071 matches juce's makeHighPass / makeLowPass default
+    static SvfCoefficients makeHighPass (double sampleRate, double frequency, double q = 0.70710678118654752)
+    {
+        return make (prewarp (sampleRate, frequency), 1.0 / q, 1.0, -1.0 / q, -1.0);
+    }
+
+    static SvfCoefficients makeLowPass (double sampleRate, double frequency, double q = 0.70710678118654752)
+    {
+        return make (prewarp (sampleRate, frequency), 1.0 / q, 0.0, 0.0, 1.0);
+    }
+
+    // Same response as the RBJ cookbook shelves juce uses (gainFactor is the linear shelf gain)
+    static SvfCoefficients makeLowShelf (double sampleRate, double frequency, double q, double gainFactor)
+    {
+        const double A = std::sqrt (std::max (0.0, gainFactor));
+        const double k = 1.0 / q;
+        return make (prewarp (sampleRate, frequency) / std::sqrt (A), k, 1.0, k * (A - 1.0), A * A - 1.0);
+    }
+
+    static SvfCoefficients makeHighShelf (double sampleRate, double frequency, double q, double gainFactor)
+    {
+        const double A = std::sqrt (std::max (0.0, gainFactor));
+        const double k = 1.0 / q;
+        return make (prewarp (sampleRate, frequency) * std::sqrt (A), k, A * A, k * (1.0 - A) * A, 1.0 - A * A);
+    }
+
+    // straight blend, fine between neighbouring settings since the structure stays stable
+    static SvfCoefficients interpolate (const SvfCoefficients& a, const SvfCoefficients& b, SampleType t)
+    {
+        return { a.a1 + t * (b.a1 - a.a1), a.a2 + t * (b.a2 - a.a2), a.a3 + t * (b.a3 - a.a3),
+                 a.m0 + t * (b.m0 - a.m0), a.m1 + t * (b.m1 - a.m1), a.m2 + t * (b.m2 - a.m2) };
+    }
+
+    bool operator== (const SvfCoefficients& other) const noexcept
+    {
+        return a1 == other.a1 && a2 == other.a2 && a3 == other.a3
+            && m0 == other.m0 && m1 == other.m1 && m2 == other.m2;
+    }
+
+    bool operator!= (const SvfCoefficients& other) const noexcept { return ! (*this == other); }
+
+    private:
+    static double prewarp (double sampleRate, double frequency)
+    {
+        const double pi = 3.14159265358979323846;
+        return std::tan (pi * std::min (frequency, 0.49 * sampleRate) / sampleRate);
+    }
+
+    static SvfCoefficients make (double g, double k, double m0, double m1, double m2)
+    {
+        const double a1 = 1.0 / (1.0 + g * (g + k));
+        const double a2 = g * a1;
+        const double a3 = g * a2;
+        return { (SampleType) a1, (SampleType) a2, (SampleType) a3, (SampleType) m0, (SampleType) m1, (SampleType) m2 };
+    }
+};
+
+// Trapezoidal state variable filter, drop in for a ProcessorChain slot (mono, one per chain)
+template <typename SampleType>
+class TptSvf
+{
+    public:
+    void setCoefficients (const SvfCoefficients<SampleType>& newCoefficients) noexcept { coefficients = newCoefficients; }
+    const SvfCoefficients<SampleType>& getCoefficients() const noexcept { return coefficients; }
+
+    // the filter's memory, exposed so mono filters can be packed into SIMD lanes and back
+    struct State
+    {
+        SampleType ic1eq, ic2eq;
+    };
+
+    State getState() const noexcept { return { ic1eq, ic2eq }; }
+    void setState (const State& newState) noexcept { ic1eq = newState.ic1eq; ic2eq = newState.ic2eq; }
+
+    template <typename ProcessSpec>
+    void prepare (const ProcessSpec&) noexcept
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        ic1eq = ic2eq = SampleType (0);
+    }
+
+    SampleType processSample (SampleType x, const SvfCoefficients<SampleType>& c) noexcept
+    {
+        const SampleType v3 = x - ic2eq;
+        const SampleType v1 = c.a1 * ic1eq + c.a2 * v3;
+        const SampleType v2 = ic2eq + c.a2 * ic1eq + c.a3 * v3;
+
+        ic1eq = SampleType (2) * v1 - ic1eq;
+        ic2eq = SampleType (2) * v2 - ic2eq;
+
+        return c.m0 * x + c.m1 * v1 + c.m2 * v2;
+    }
+
+    SampleType processSample (SampleType x) noexcept
+    {
+        return processSample (x, coefficients);
+    }
+
+    // state lives in locals for the whole loop so it stays in registers
+    void processSamples (SampleType* data, int numSamples) noexcept
+    {
+        const auto c = coefficients;
+        SampleType s1 = ic1eq, s2 = ic2eq;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const SampleType x = data[i];
+            const SampleType v3 = x - s2;
+            const SampleType v1 = c.a1 * s1 + c.a2 * v3;
+            const SampleType v2 = s2 + c.a2 * s1 + c.a3 * v3;
+
+            s1 = SampleType (2) * v1 - s1;
+            s2 = SampleType (2) * v2 - s2;
+
+            data[i] = c.m0 * x + c.m1 * v1 + c.m2 * v2;
+        }
+
+        ic1eq = s1;
+        ic2eq = s2;
+    }
+
+    template <typename ProcessContext>
+    void process (const ProcessContext& context) noexcept
+    {
+        auto&& inputBlock = context.getInputBlock();
+        auto&& outputBlock = context.getOutputBlock();
+        const int numSamples = (int) outputBlock.getNumSamples();
+
+        for (size_t channel = 0; channel < outputBlock.getNumChannels(); ++channel)
+        {
+            const SampleType* input = inputBlock.getChannelPointer (channel);
+            SampleType* output = outputBlock.getChannelPointer (channel);
+
+            if (input != output)
+                std::copy (input, input + numSamples, output);
+
+            if (! context.isBypassed)
+                processSamples (output, numSamples);
+        }
+    }
+
+    private:
+    SvfCoefficients<SampleType> coefficients;
+    SampleType ic1eq = 0, ic2eq = 0;
+};
+
+// Trapezoidal one-pole low-pass, same response as juce's makeFirstOrderLowPass
+template <typename SampleType>
+class TptOnePole
+{
+    public:
+    void setCutoff (double sampleRate, double frequency) noexcept
+    {
+        const double pi = 3.14159265358979323846;
+        const double g = std::tan (pi * std::min (frequency, 0.49 * sampleRate) / sampleRate);
+        G = (SampleType) (g / (1.0 + g));
+    }
+
+    SampleType getCoefficient() const noexcept { return G; }
+
+    SampleType getState() const noexcept { return s; }
+    void setState (SampleType newState) noexcept { s = newState; }
+
+    template <typename ProcessSpec>
+    void prepare (const ProcessSpec&) noexcept
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        s = SampleType (0);
+    }
+
+    SampleType processSample (SampleType x) noexcept
+    {
+        const SampleType v = (x - s) * G;
+        const SampleType y = v + s;
+        s = y + v;
+        return y;
+    }
+
+    void processSamples (SampleType* data, int numSamples) noexcept
+    {
+        const SampleType g = G;
+        SampleType state = s;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const SampleType v = (data[i] - state) * g;
+            const SampleType y = v + state;
+            state = y + v;
+            data[i] = y;
+        }
+
+        s = state;
+    }
+
+    template <typename ProcessContext>
+    void process (const ProcessContext& context) noexcept
+    {
+        auto&& inputBlock = context.getInputBlock();
+        auto&& outputBlock = context.getOutputBlock();
+        const int numSamples = (int) outputBlock.getNumSamples();
+
+        for (size_t channel = 0; channel < outputBlock.getNumChannels(); ++channel)
+        {
+            const SampleType* input = inputBlock.getChannelPointer (channel);
+            SampleType* output = outputBlock.getChannelPointer (channel);
+
+            if (input != output)
+                std::copy (input, input + numSamples, output);
+
+            if (! context.isBypassed)
+                processSamples (output, numSamples);
+        }
+    }
+
+    private:
+    SampleType G = 0;
+    SampleType s = 0;
+};
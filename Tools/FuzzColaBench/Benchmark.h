@@ -0,0 +1,222 @@
+/*
+ ==============================================================================
+
+ Benchmark.h
+ Times benchmark cases, writes the results as JSON and compares two sets of them.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace Benchmark
+{
+    // One thing to time. make() sets it all up (allocations, prepare, the test signal) and hands
+    // back the step, which does one block's worth of work and returns how many items it did
+    // (samples per channel for audio, calls for the per call cases). Setup never gets timed
+    struct Case
+    {
+        using Step = std::function<juce::int64()>;
+
+        juce::String name;                  // "group/what/variant", what --filter and the comparison match on
+        juce::String unit = "ns/sample";
+        double sampleRate = 0.0;            // for the realtime load, 0 if it doesn't apply
+        juce::NamedValueSet params;         // the settings, just passed through to the JSON
+        std::function<Step()> make;
+    };
+
+    struct Result
+    {
+        juce::String name;
+        juce::String unit;
+        double median = 0.0;                // per item, over the repetitions
+        double min = 0.0;
+        double max = 0.0;
+        double sampleRate = 0.0;
+        juce::NamedValueSet params;
+
+        // percent of one core to keep up in realtime, for audio cases
+        double getRealtimeLoad() const noexcept { return sampleRate > 0.0 ? median * sampleRate * 1.0e-7 : 0.0; }
+    };
+
+    struct Settings
+    {
+        double warmupSeconds = 0.05;
+        double repetitionSeconds = 0.05;    // each repetition runs at least this long
+        int repetitions = 7;
+    };
+
+    inline double secondsSince (juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    // The warm up gets the caches, branch predictors and clock up to speed and says how many steps
+    // fill a repetition. The median is what gets compared (one slow repetition from the OS doing
+    // something doesn't move it), the min is close to what the code can do on a quiet machine
+    inline Result run (const Case& benchmarkCase, const Settings& settings)
+    {
+        juce::ScopedNoDenormals noDenormals;
+        const Case::Step step = benchmarkCase.make();
+
+        juce::int64 warmupSteps = 0;
+        const auto warmupStart = juce::Time::getHighResolutionTicks();
+
+        while (warmupSteps < 2 || secondsSince (warmupStart) < settings.warmupSeconds)
+        {
+            step();
+            ++warmupSteps;
+        }
+
+        const double secondsPerStep = secondsSince (warmupStart) / (double) warmupSteps;
+        const auto stepsPerRepetition = juce::jmax ((juce::int64) 1, (juce::int64) std::ceil (settings.repetitionSeconds / secondsPerStep));
+
+        std::vector<double> timings;
+
+        for (int r = 0; r < juce::jmax (1, settings.repetitions); ++r)
+        {
+            juce::int64 items = 0;
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (juce::int64 s = 0; s < stepsPerRepetition; ++s)
+                items += step();
+
+            timings.push_back (secondsSince (start) * 1.0e9 / (double) juce::jmax ((juce::int64) 1, items));
+        }
+
+        std::sort (timings.begin(), timings.end());
+
+        Result result;
+        result.name = benchmarkCase.name;
+        result.unit = benchmarkCase.unit;
+        result.median = timings[timings.size() / 2];
+        result.min = timings.front();
+        result.max = timings.back();
+        result.sampleRate = benchmarkCase.sampleRate;
+        result.params = benchmarkCase.params;
+        return result;
+    }
+
+    //==============================================================================
+    inline juce::var toJson (const std::vector<Result>& results, const juce::NamedValueSet& machine, const Settings& settings)
+    {
+        auto round = [] (double value) { return std::round (value * 1000.0) / 1000.0; };
+
+        juce::Array<juce::var> cases;
+
+        for (const auto& result : results)
+        {
+            juce::DynamicObject::Ptr entry (new juce::DynamicObject());
+            entry->setProperty ("name", result.name);
+            entry->setProperty ("unit", result.unit);
+            entry->setProperty ("median", round (result.median));
+            entry->setProperty ("min", round (result.min));
+            entry->setProperty ("max", round (result.max));
+
+            if (result.sampleRate > 0.0)
+                entry->setProperty ("realtimeLoadPercent", round (result.getRealtimeLoad()));
+
+            juce::DynamicObject::Ptr params (new juce::DynamicObject());
+
+            for (const auto& param : result.params)
+                params->setProperty (param.name, param.value);
+
+            entry->setProperty ("params", juce::var (params.get()));
+            cases.add (juce::var (entry.get()));
+        }
+
+        juce::DynamicObject::Ptr machineObject (new juce::DynamicObject());
+
+        for (const auto& property : machine)
+            machineObject->setProperty (property.name, property.value);
+
+        juce::DynamicObject::Ptr settingsObject (new juce::DynamicObject());
+        settingsObject->setProperty ("warmupSeconds", settings.warmupSeconds);
+        settingsObject->setProperty ("repetitionSeconds", settings.repetitionSeconds);
+        settingsObject->setProperty ("repetitions", settings.repetitions);
+
+        juce::DynamicObject::Ptr root (new juce::DynamicObject());
+        root->setProperty ("format", "FuzzColaBench");
+        root->setProperty ("version", 1);
+        root->setProperty ("date", juce::Time::getCurrentTime().toISO8601 (true));
+        root->setProperty ("machine", juce::var (machineObject.get()));
+        root->setProperty ("settings", juce::var (settingsObject.get()));
+        root->setProperty ("results", cases);
+        return juce::var (root.get());
+    }
+
+    // false if it isn't one of ours
+    inline bool fromJson (const juce::var& json, std::vector<Result>& results)
+    {
+        const juce::var entries = json.getProperty ("results", {});
+
+        if (json.getProperty ("format", {}).toString() != "FuzzColaBench" || ! entries.isArray())
+            return false;
+
+        for (const auto& entry : *entries.getArray())
+        {
+            Result result;
+            result.name = entry.getProperty ("name", {}).toString();
+            result.unit = entry.getProperty ("unit", "ns/sample").toString();
+            result.median = entry.getProperty ("median", 0.0);
+            result.min = entry.getProperty ("min", 0.0);
+            result.max = entry.getProperty ("max", 0.0);
+
+            if (result.name.isNotEmpty() && result.median > 0.0)
+                results.push_back (result);
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    struct Comparison
+    {
+        juce::String name;
+        juce::String unit;
+        double baseline = 0.0;
+        double current = 0.0;
+        double changePercent = 0.0;         // of the time taken, positive is slower
+        bool regressed = false;
+        bool improved = false;
+    };
+
+    // A case only counts as a regression when its median AND its min are both more than
+    // thresholdPercent slower, a noisy run moves the median but rarely the best repetition too.
+    // Cases only in one of the two sets are left out (renamed, added or filtered away)
+    inline std::vector<Comparison> compare (const std::vector<Result>& baseline, const std::vector<Result>& current,
+                                            double thresholdPercent)
+    {
+        std::vector<Comparison> comparisons;
+
+        for (const auto& now : current)
+        {
+            const auto before = std::find_if (baseline.begin(), baseline.end(), [&now] (const Result& r)
+            {
+                return r.name == now.name && r.unit == now.unit;
+            });
+
+            if (before == baseline.end())
+                continue;
+
+            auto change = [] (double from, double to) { return from > 0.0 ? (to / from - 1.0) * 100.0 : 0.0; };
+
+            Comparison comparison;
+            comparison.name = now.name;
+            comparison.unit = now.unit;
+            comparison.baseline = before->median;
+            comparison.current = now.median;
+            comparison.changePercent = change (before->median, now.median);
+            comparison.regressed = comparison.changePercent > thresholdPercent
+                                && (before->min <= 0.0 || change (before->min, now.min) > thresholdPercent);
+            comparison.improved = comparison.changePercent < -thresholdPercent;
+            comparisons.push_back (comparison);
+        }
+
+        return comparisons;
+    }
+}
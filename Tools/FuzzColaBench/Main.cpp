@@ -0,0 +1,949 @@
+/*
+ ==============================================================================
+
+ Main.cpp
+ FuzzColaBench: ns/sample for the whole pedal and its stages, with a regression check.
+
+ ==============================================================================
+ */
+
+#include <juce_dsp/juce_dsp.h>
+#include <iostream>
+#include "FuzzColaEngine.h"
+#include "Benchmark.h"
+
+namespace
+{
+    const char* const usage =
+        "Usage: FuzzColaBench [options]\n"
+        "\n"
+        "Times the pedal the way processBlock runs it (FuzzColaEngine) across block sizes, sample rates,\n"
+        "channel counts and quality settings, its stages on their own, and blocks full of parameter\n"
+        "changes. FUZZCOLA_KERNELS=generic|sse2|avx2|avx512|neon picks the SIMD kernels.\n"
+        "\n"
+        "  --filter <text>        only the cases with text in their name (give it more than once for any of them)\n"
+        "  --list                 prints the case names and stops\n"
+        "  --quick                shorter runs, noisier, for a quick look\n"
+        "  --repetitions <n>      timed repetitions per case (default 7), the median gets reported\n"
+        "  --output <file>        writes the results as JSON\n"
+        "  --baseline <file>      compares with an earlier --output, exits with 1 if anything got slower\n"
+        "  --threshold <percent>  how much slower counts as a regression (default 10)\n"
+        "  --compare <old> <new>  compares two saved runs without running anything\n"
+        "  --check-latency        checks the oversampler's reported latency against an impulse, exits with 1 if they differ\n";
+
+    //==============================================================================
+    // A couple of seconds of something like a guitar: plucked notes with a few harmonics over a
+    // little noise, peaking around -10 dBFS, so the clippers see everything from the attack down
+    // to the decay and the silence detection never kicks in
+    class TestSignal
+    {
+        public:
+        explicit TestSignal (double sampleRate)
+        {
+            const double notes[] = { 82.41, 110.0, 146.83, 196.0, 246.94, 329.63, 196.0, 110.0 };
+            const int noteLength = (int) (0.25 * sampleRate);
+            const double twoPi = juce::MathConstants<double>::twoPi;
+
+            juce::Random random (1234);
+            samples.resize ((size_t) (noteLength * (int) std::size (notes)));
+
+            for (size_t n = 0; n < std::size (notes); ++n)
+            {
+                for (int i = 0; i < noteLength; ++i)
+                {
+                    const double t = i / sampleRate;
+                    double sum = 0.0;
+
+                    for (int harmonic = 1; harmonic <= 6; ++harmonic)
+                        sum += std::sin (twoPi * notes[n] * harmonic * t) / harmonic;
+
+                    const double noise = 0.002 * (random.nextDouble() * 2.0 - 1.0);
+                    samples[n * (size_t) noteLength + (size_t) i] = (float) (0.15 * sum * std::exp (-t / 0.15) + noise);
+                }
+            }
+        }
+
+        // the next numSamples (wrapping round), offset further along, times gain
+        template <typename SampleType>
+        void read (SampleType* destination, int numSamples, int offset = 0, float gain = 1.0f) const noexcept
+        {
+            size_t index = (position + (size_t) offset) % samples.size();
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                destination[i] = (SampleType) (samples[index] * gain);
+
+                if (++index == samples.size())
+                    index = 0;
+            }
+        }
+
+        void advance (int numSamples) noexcept
+        {
+            position = (position + (size_t) numSamples) % samples.size();
+        }
+
+        private:
+        std::vector<float> samples;
+        size_t position = 0;
+    };
+
+    // 100 ms of decaying, darkened noise, about as long as a close miked cab IR
+    std::shared_ptr<const ImpulseResponse> makeCabinet (double sampleRate)
+    {
+        std::vector<float> samples ((size_t) (0.1 * sampleRate));
+        juce::Random random (42);
+        float lowPassed = 0.0f;
+
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            lowPassed += 0.3f * ((random.nextFloat() * 2.0f - 1.0f) - lowPassed);
+            samples[i] = lowPassed * (float) std::exp (-(double) i / (0.015 * sampleRate));
+        }
+
+        return std::make_shared<const ImpulseResponse> (std::move (samples), "Benchmark");
+    }
+
+    //==============================================================================
+    // The whole pedal through FuzzColaEngine, which is all processBlock adds MIDI and the APVTS to
+    struct EngineSetup
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int numChannels = 2;
+        bool identicalChannels = false;     // stereo with the same signal both sides (one chain runs)
+        bool doublePrecision = false;
+        bool silentInput = false;
+        bool cabinet = false;
+        FuzzColaParameters parameters;
+        FuzzColaEngineOptions options;
+
+        // called before every block with how many samples have gone through, for the automation cases
+        std::function<void (FuzzColaParameters&, juce::int64)> automate;
+    };
+
+    template <typename SampleType>
+    Benchmark::Case::Step makeEngineStep (const EngineSetup& setup)
+    {
+        struct State
+        {
+            explicit State (double sampleRate) : signal (sampleRate) {}
+
+            FuzzColaEngine engine;
+            juce::AudioBuffer<SampleType> buffer;
+            TestSignal signal;
+            FuzzColaParameters parameters;
+            juce::int64 samplesDone = 0;
+        };
+
+        auto state = std::make_shared<State> (setup.sampleRate);
+        state->parameters = setup.parameters;
+        state->buffer.setSize (setup.numChannels, setup.blockSize);
+        state->engine.setOptions (setup.options);
+        state->engine.setParameters (setup.parameters);
+        state->engine.prepare (setup.sampleRate, setup.blockSize);
+
+        if (setup.cabinet)
+            state->engine.setImpulseResponse (makeCabinet (setup.sampleRate));
+
+        state->engine.reset();
+
+        return [state, setup]() -> juce::int64
+        {
+            if (setup.automate != nullptr)
+            {
+                setup.automate (state->parameters, state->samplesDone);
+                state->engine.setParameters (state->parameters);
+            }
+
+            for (int channel = 0; channel < setup.numChannels; ++channel)
+            {
+                SampleType* data = state->buffer.getWritePointer (channel);
+
+                if (setup.silentInput)
+                    std::fill (data, data + setup.blockSize, SampleType (0));
+                else
+                    state->signal.read (data, setup.blockSize, channel == 0 || setup.identicalChannels ? 0 : 37);
+            }
+
+            state->signal.advance (setup.blockSize);
+            state->engine.process (state->buffer.getArrayOfWritePointers(), setup.numChannels, setup.numChannels, setup.blockSize);
+            state->samplesDone += setup.blockSize;
+            return setup.blockSize;
+        };
+    }
+
+    Benchmark::Case makeEngineCase (const juce::String& name, const EngineSetup& setup)
+    {
+        const FuzzColaParameters& p = setup.parameters;
+
+        Benchmark::Case benchmarkCase;
+        benchmarkCase.name = name;
+        benchmarkCase.sampleRate = setup.sampleRate;
+        benchmarkCase.params.set ("sampleRate", setup.sampleRate);
+        benchmarkCase.params.set ("blockSize", setup.blockSize);
+        benchmarkCase.params.set ("channels", setup.numChannels);
+        benchmarkCase.params.set ("identicalChannels", setup.identicalChannels);
+        benchmarkCase.params.set ("precision", setup.doublePrecision ? "double" : "float");
+        benchmarkCase.params.set ("silentInput", setup.silentInput);
+        benchmarkCase.params.set ("offline", setup.options.offline);
+        benchmarkCase.params.set ("cabinet", setup.cabinet);
+        benchmarkCase.params.set ("pedalOn", p.pedalOn);
+        benchmarkCase.params.set ("toneEnabled", p.toneEnabled);
+        benchmarkCase.params.set ("oversamplingStages", p.oversamplingStages);
+        benchmarkCase.params.set ("linearPhaseOversampling", p.linearPhaseOversampling);
+        benchmarkCase.params.set ("adaaOrder", p.adaaOrder);
+        benchmarkCase.params.set ("useClipTable", p.useClipTable);
+        benchmarkCase.params.set ("exactClippers", p.exactClippers);
+        benchmarkCase.params.set ("circuitModel", p.circuitModel);
+        benchmarkCase.params.set ("automated", setup.automate != nullptr);
+
+        benchmarkCase.make = [setup]
+        {
+            return setup.doublePrecision ? makeEngineStep<double> (setup) : makeEngineStep<float> (setup);
+        };
+
+        return benchmarkCase;
+    }
+
+    //==============================================================================
+    // The stages on their own, mono float at 48 kHz in 512 sample blocks, the way the fused
+    // loops call them. Shaper inputs get the kind of gain SUSTAIN puts in front of them
+    constexpr double stageSampleRate = 48000.0;
+    constexpr int stageBlockSize = 512;
+
+    struct StageBuffer
+    {
+        StageBuffer() : signal (stageSampleRate), data ((size_t) stageBlockSize) {}
+
+        float* next (float gain = 1.0f)
+        {
+            signal.read (data.data(), stageBlockSize, 0, gain);
+            signal.advance (stageBlockSize);
+            return data.data();
+        }
+
+        TestSignal signal;
+        std::vector<float> data;
+    };
+
+    // process is given the stage and the block, make the stage before the first block
+    template <typename Stage, typename ProcessFunction>
+    Benchmark::Case makeStageCase (const juce::String& name, std::function<void (Stage&)> setUp, ProcessFunction process,
+                                   float inputGain = 1.0f)
+    {
+        Benchmark::Case benchmarkCase;
+        benchmarkCase.name = name;
+        benchmarkCase.sampleRate = stageSampleRate;
+        benchmarkCase.params.set ("sampleRate", stageSampleRate);
+        benchmarkCase.params.set ("blockSize", stageBlockSize);
+
+        benchmarkCase.make = [setUp, process, inputGain]() -> Benchmark::Case::Step
+        {
+            struct State
+            {
+                Stage stage;
+                StageBuffer buffer;
+            };
+
+            auto state = std::make_shared<State>();
+            setUp (state->stage);
+
+            return [state, process, inputGain]() -> juce::int64
+            {
+                process (state->stage, state->buffer.next (inputGain), stageBlockSize);
+                return stageBlockSize;
+            };
+        };
+
+        return benchmarkCase;
+    }
+
+    template <typename Curve>
+    void addShaperCases (std::vector<Benchmark::Case>& cases, const juce::String& curveName)
+    {
+        const std::pair<ShaperMode, const char*> modes[] =
+        {
+            { ShaperMode::fast, "fast" },
+            { ShaperMode::adaaFirstOrder, "adaa1" },
+            { ShaperMode::adaaSecondOrder, "adaa2" },
+            { ShaperMode::exact, "exact" }
+        };
+
+        for (const auto& [mode, modeName] : modes)
+        {
+            cases.push_back (makeStageCase<ShaperStage<Curve, float>> ("stage/shaper/" + curveName + "/" + modeName,
+                [mode = mode] (ShaperStage<Curve, float>& shaper) { shaper.setMode (mode); },
+                [] (ShaperStage<Curve, float>& shaper, float* data, int numSamples) { shaper.processSamples (data, numSamples); },
+                8.0f));
+        }
+    }
+
+   #if JUCE_USE_SIMD
+    // Input gain + the 30 Hz HPF on a stereo pair in the fused engine's 64 sample tiles, both ways
+    // FuzzColaDsp::processFusedVariant can run them: one channel after the other, or the two side
+    // by side in SIMD lanes, paying for the pack and interleave there and back every tile.
+    // The lanes only earn their place if they come out ahead of per-channel here
+    Benchmark::Case makePreClipperCase (const juce::String& name, bool useLanes)
+    {
+        Benchmark::Case benchmarkCase;
+        benchmarkCase.name = name;
+        benchmarkCase.sampleRate = stageSampleRate;
+        benchmarkCase.params.set ("sampleRate", stageSampleRate);
+        benchmarkCase.params.set ("blockSize", stageBlockSize);
+        benchmarkCase.params.set ("channels", 2);
+
+        benchmarkCase.make = [useLanes]() -> Benchmark::Case::Step
+        {
+            using Lanes = LaneFilters::Lanes<float>;
+            constexpr int tileSize = 64;
+
+            struct State
+            {
+                TptSvf<float> filters[2];
+                StageBuffer buffers[2];
+                alignas (Lanes) std::array<float, tileSize * Lanes::size()> laneBuffer {};
+            };
+
+            auto state = std::make_shared<State>();
+
+            for (auto& filter : state->filters)
+                filter.setCoefficients (SvfCoefficients<float>::makeHighPass (stageSampleRate, 30.0));
+
+            return [state, useLanes]() -> juce::int64
+            {
+                const float gains[2] = { 2.5f, 2.5f };
+                float* channels[2] = { state->buffers[0].next(), state->buffers[1].next() };
+
+                for (int start = 0; start < stageBlockSize; start += tileSize)
+                {
+                    const int length = juce::jmin (tileSize, stageBlockSize - start);
+                    float* tiles[2] = { channels[0] + start, channels[1] + start };
+
+                    if (useLanes)
+                    {
+                        TptSvf<float>* filters[2] = { &state->filters[0], &state->filters[1] };
+                        const auto gain = LaneFilters::packValues (gains, 2);
+                        auto hpf = LaneFilters::pack (filters, 2);
+
+                        LaneFilters::interleave (tiles, 2, length, state->laneBuffer.data());
+
+                        for (int i = 0; i < length; ++i)
+                        {
+                            float* frame = state->laneBuffer.data() + (size_t) i * Lanes::size();
+                            hpf.processSample (gain * Lanes::fromRawArray (frame)).copyToRawArray (frame);
+                        }
+
+                        LaneFilters::deinterleave (state->laneBuffer.data(), tiles, 2, length);
+                        LaneFilters::unpack (hpf, filters, 2);
+                    }
+                    else
+                    {
+                        for (int c = 0; c < 2; ++c)
+                        {
+                            auto hpf = state->filters[c];
+
+                            for (int i = 0; i < length; ++i)
+                                tiles[c][i] = hpf.processSample (gains[c] * tiles[c][i]);
+
+                            state->filters[c] = hpf;
+                        }
+                    }
+                }
+
+                return stageBlockSize;
+            };
+        };
+
+        return benchmarkCase;
+    }
+   #endif
+
+    juce::dsp::ProcessSpec getStageSpec()
+    {
+        return { stageSampleRate, (juce::uint32) stageBlockSize, 1 };
+    }
+
+    void processToneStack (ToneStack<float>& toneStack, float* data, int numSamples)
+    {
+        float* channels[] = { data };
+        juce::dsp::AudioBlock<float> block (channels, 1, (size_t) numSamples);
+        toneStack.process (juce::dsp::ProcessContextReplacing<float> (block));
+    }
+
+    //==============================================================================
+    std::vector<Benchmark::Case> makeCases()
+    {
+        std::vector<Benchmark::Case> cases;
+
+        // Everything below is the base with one thing changed: 48 kHz, 512 samples, stereo, tone on,
+        // the anti-aliasing as it comes (no oversampling, no ADAA, fast tanh)
+        const EngineSetup base;
+        cases.push_back (makeEngineCase ("engine/base", base));
+
+        for (int blockSize = 16; blockSize <= 4096; blockSize *= 2)
+        {
+            EngineSetup setup = base;
+            setup.blockSize = blockSize;
+            cases.push_back (makeEngineCase ("engine/block/" + juce::String (blockSize), setup));
+        }
+
+        for (double sampleRate : { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 })
+        {
+            EngineSetup setup = base;
+            setup.sampleRate = sampleRate;
+            cases.push_back (makeEngineCase ("engine/rate/" + juce::String ((int) sampleRate), setup));
+        }
+
+        {
+            EngineSetup mono = base;
+            mono.numChannels = 1;
+            cases.push_back (makeEngineCase ("engine/channels/mono", mono));
+
+            cases.push_back (makeEngineCase ("engine/channels/stereo", base));
+
+            EngineSetup identical = base;
+            identical.identicalChannels = true;
+            cases.push_back (makeEngineCase ("engine/channels/stereo-identical", identical));
+        }
+
+        {
+            cases.push_back (makeEngineCase ("engine/tone/on", base));
+
+            EngineSetup toneOff = base;
+            toneOff.parameters.toneEnabled = false;
+            cases.push_back (makeEngineCase ("engine/tone/off", toneOff));
+        }
+
+        {
+            EngineSetup bypassed = base;
+            bypassed.parameters.pedalOn = false;
+            cases.push_back (makeEngineCase ("engine/bypass", bypassed));
+
+            EngineSetup silent = base;
+            silent.silentInput = true;
+            cases.push_back (makeEngineCase ("engine/silence", silent));
+        }
+
+        // Every quality setting the plugin has, on the base
+        struct Quality
+        {
+            const char* name;
+            std::function<void (EngineSetup&)> apply;
+        };
+
+        const Quality qualities[] =
+        {
+            { "os-2x", [] (EngineSetup& s) { s.parameters.oversamplingStages = 1; } },
+            { "os-4x", [] (EngineSetup& s) { s.parameters.oversamplingStages = 2; } },
+            { "os-8x", [] (EngineSetup& s) { s.parameters.oversamplingStages = 3; } },
+            { "os-2x-linear", [] (EngineSetup& s) { s.parameters.oversamplingStages = 1; s.parameters.linearPhaseOversampling = true; } },
+            { "os-8x-linear", [] (EngineSetup& s) { s.parameters.oversamplingStages = 3; s.parameters.linearPhaseOversampling = true; } },
+            { "adaa-1", [] (EngineSetup& s) { s.parameters.adaaOrder = 1; } },
+            { "adaa-2", [] (EngineSetup& s) { s.parameters.adaaOrder = 2; } },
+            { "adaa-1-os-2x", [] (EngineSetup& s) { s.parameters.adaaOrder = 1; s.parameters.oversamplingStages = 1; } },
+            { "cliptable", [] (EngineSetup& s) { s.parameters.useClipTable = true; } },
+            { "exact", [] (EngineSetup& s) { s.parameters.exactClippers = true; } },
+            { "double", [] (EngineSetup& s) { s.doublePrecision = true; } },
+            { "offline-render", [] (EngineSetup& s) { s.options.offline = true; } },
+            { "circuit", [] (EngineSetup& s) { s.parameters.circuitModel = true; } },
+            { "circuit-os-2x", [] (EngineSetup& s) { s.parameters.circuitModel = true; s.parameters.oversamplingStages = 1; } },
+            { "circuit-os-4x", [] (EngineSetup& s) { s.parameters.circuitModel = true; s.parameters.oversamplingStages = 2; } },
+            { "cabinet", [] (EngineSetup& s) { s.cabinet = true; } }
+        };
+
+        for (const auto& quality : qualities)
+        {
+            EngineSetup setup = base;
+            quality.apply (setup);
+            cases.push_back (makeEngineCase ("engine/quality/" + juce::String (quality.name), setup));
+        }
+
+        // Parameter changes every block, small blocks the way hosts with sample accurate
+        // automation (and the MIDI CC splitting) hand them over
+        {
+            EngineSetup knobs = base;
+            knobs.blockSize = 64;
+            knobs.automate = [rate = base.sampleRate] (FuzzColaParameters& p, juce::int64 samplesDone)
+            {
+                const double t = (double) samplesDone / rate;
+                const double twoPi = juce::MathConstants<double>::twoPi;
+                p.sustain = (float) (0.5 + 0.4 * std::sin (twoPi * 0.9 * t));
+                p.tone = (float) (0.5 + 0.45 * std::sin (twoPi * 1.3 * t));
+                p.volumeDb = (float) (-6.0 + 6.0 * std::sin (twoPi * 0.7 * t));
+            };
+            cases.push_back (makeEngineCase ("automation/knobs", knobs));
+
+            EngineSetup knobsOversampled = knobs;
+            knobsOversampled.parameters.oversamplingStages = 2;
+            knobsOversampled.parameters.adaaOrder = 1;
+            cases.push_back (makeEngineCase ("automation/knobs-os-4x-adaa-1", knobsOversampled));
+
+            // a step of the TONE knob every 32 samples, back and forth across its range
+            EngineSetup toneSweep = base;
+            toneSweep.blockSize = 32;
+            toneSweep.automate = [] (FuzzColaParameters& p, juce::int64 samplesDone)
+            {
+                const int step = (int) ((samplesDone / 32) % 200);
+                p.tone = (float) (step < 100 ? step : 200 - step) * 0.01f;
+            };
+            cases.push_back (makeEngineCase ("automation/tone-sweep", toneSweep));
+
+            EngineSetup footswitch = base;
+            footswitch.blockSize = 128;
+            footswitch.automate = [] (FuzzColaParameters& p, juce::int64 samplesDone) { p.pedalOn = (samplesDone / 4096) % 2 == 0; };
+            cases.push_back (makeEngineCase ("automation/footswitch", footswitch));
+
+            EngineSetup oversampling = base;
+            oversampling.blockSize = 256;
+            oversampling.automate = [] (FuzzColaParameters& p, juce::int64 samplesDone) { p.oversamplingStages = (int) ((samplesDone / 16384) % 4); };
+            cases.push_back (makeEngineCase ("automation/oversampling", oversampling));
+
+            EngineSetup adaa = base;
+            adaa.blockSize = 256;
+            adaa.automate = [] (FuzzColaParameters& p, juce::int64 samplesDone) { p.adaaOrder = (int) ((samplesDone / 8192) % 3); };
+            cases.push_back (makeEngineCase ("automation/adaa", adaa));
+
+            EngineSetup engineSwitch = base;
+            engineSwitch.blockSize = 256;
+            engineSwitch.automate = [] (FuzzColaParameters& p, juce::int64 samplesDone) { p.circuitModel = (samplesDone / 16384) % 2 == 1; };
+            cases.push_back (makeEngineCase ("automation/engine", engineSwitch));
+        }
+
+        // Tone stack: at rest, gliding the whole time, and what a setTone call costs by itself
+        cases.push_back (makeStageCase<ToneStack<float>> ("stage/tonestack/static",
+            [] (ToneStack<float>& toneStack) { toneStack.prepare (getStageSpec()); toneStack.setTone (0.7f); },
+            processToneStack));
+
+        {
+            auto block = std::make_shared<int> (0);
+
+            cases.push_back (makeStageCase<ToneStack<float>> ("stage/tonestack/glide",
+                [] (ToneStack<float>& toneStack) { toneStack.prepare (getStageSpec()); },
+                [block] (ToneStack<float>& toneStack, float* data, int numSamples)
+                {
+                    // a new target every block, each glide is longer than the block
+                    toneStack.setTone ((*block)++ % 2 == 0 ? 0.2f : 0.8f);
+                    processToneStack (toneStack, data, numSamples);
+                }));
+        }
+
+        {
+            Benchmark::Case setTone;
+            setTone.name = "stage/tonestack/setTone";
+            setTone.unit = "ns/call";
+            setTone.make = []() -> Benchmark::Case::Step
+            {
+                auto toneStack = std::make_shared<ToneStack<float>>();
+                toneStack->prepare (getStageSpec());
+
+                return [toneStack]() -> juce::int64
+                {
+                    constexpr int numCalls = 256;
+
+                    for (int i = 0; i < numCalls; ++i)
+                        toneStack->setTone ((float) (i % 101) * 0.01f);
+
+                    return numCalls;
+                };
+            };
+            cases.push_back (setTone);
+        }
+
+        addShaperCases<SymmetricClipCurve> (cases, "symmetric");
+        addShaperCases<OffsetClipCurve> (cases, "offset");
+
+        cases.push_back (makeStageCase<std::shared_ptr<const CompositeClipTable>> ("stage/cliptable",
+            [] (std::shared_ptr<const CompositeClipTable>& table) { table = CompositeClipTable::getShared(); },
+            [] (std::shared_ptr<const CompositeClipTable>& table, float* data, int numSamples) { table->processBlock (data, numSamples); },
+            8.0f));
+
+        {
+            const auto shelf = SvfCoefficients<float>::makeLowShelf (stageSampleRate, 250.0, 0.707, 2.0);
+
+            cases.push_back (makeStageCase<TptSvf<float>> ("stage/filter/svf",
+                [shelf] (TptSvf<float>& filter) { filter.setCoefficients (shelf); },
+                [] (TptSvf<float>& filter, float* data, int numSamples) { filter.processSamples (data, numSamples); }));
+
+            cases.push_back (makeStageCase<TptOnePole<float>> ("stage/filter/onepole",
+                [] (TptOnePole<float>& filter) { filter.setCutoff (stageSampleRate, 5000.0); },
+                [] (TptOnePole<float>& filter, float* data, int numSamples) { filter.processSamples (data, numSamples); }));
+
+            using StateSpaceFilter = std::pair<BlockStateSpace<float, 2>, BlockStateSpace<float, 2>::State>;
+
+            cases.push_back (makeStageCase<StateSpaceFilter> ("stage/filter/statespace",
+                [shelf] (StateSpaceFilter& filter) { filter.first.setSystem (StateSpace::fromSvf (shelf)); filter.second = {}; },
+                [] (StateSpaceFilter& filter, float* data, int numSamples) { filter.first.process (data, numSamples, filter.second, 1.0f); }));
+        }
+
+       #if JUCE_USE_SIMD
+        cases.push_back (makePreClipperCase ("stage/preclipper/per-channel", false));
+        cases.push_back (makePreClipperCase ("stage/preclipper/lanes", true));
+       #endif
+
+        // up and back down again, per sample at the base rate
+        for (int stages = 1; stages <= 3; ++stages)
+        {
+            for (auto type : { HalfBandOversampler<float>::FilterType::iir, HalfBandOversampler<float>::FilterType::linearPhase })
+            {
+                const juce::String name = "stage/oversampler/" + juce::String (1 << stages) + "x"
+                                        + (type == HalfBandOversampler<float>::FilterType::iir ? "" : "-linear");
+
+                cases.push_back (makeStageCase<HalfBandOversampler<float>> (name,
+                    [stages, type] (HalfBandOversampler<float>& oversampler)
+                    {
+                        oversampler.prepare (1, stageBlockSize);
+                        oversampler.setMode (stages, type);
+                    },
+                    [] (HalfBandOversampler<float>& oversampler, float* data, int numSamples)
+                    {
+                        oversampler.processUp (0, data, numSamples);
+                        oversampler.processDown (0, data, numSamples);
+                    }));
+            }
+        }
+
+        return cases;
+    }
+
+    //==============================================================================
+    juce::NamedValueSet describeMachine()
+    {
+        juce::NamedValueSet machine;
+        machine.set ("cpu", juce::SystemStats::getCpuModel());
+        machine.set ("logicalCores", juce::SystemStats::getNumCpus());
+        machine.set ("physicalCores", juce::SystemStats::getNumPhysicalCpus());
+        machine.set ("os", juce::SystemStats::getOperatingSystemName());
+        machine.set ("kernels", juce::String (DspKernels::getIsaName (DspKernels::getActiveIsa())));
+       #if JUCE_DEBUG
+        machine.set ("build", "debug");
+       #else
+        machine.set ("build", "release");
+       #endif
+        return machine;
+    }
+
+    // how many more runs a case that looks slower than the baseline gets
+    constexpr int numRechecks = 2;
+
+    juce::String formatNumber (double value, int decimals = 2)
+    {
+        return juce::String (value, decimals);
+    }
+
+    bool loadResults (const juce::File& file, std::vector<Benchmark::Result>& results, juce::String& cpu)
+    {
+        const juce::var json = juce::JSON::parse (file);
+        cpu = json.getProperty ("machine", {}).getProperty ("cpu", {}).toString();
+
+        if (Benchmark::fromJson (json, results))
+            return true;
+
+        std::cerr << "Couldn't read benchmark results from " << file.getFullPathName() << "\n";
+        return false;
+    }
+
+    // Prints every case both sets have, slowest change first. True if nothing regressed
+    bool printComparison (const std::vector<Benchmark::Result>& baseline, const std::vector<Benchmark::Result>& current,
+                          double thresholdPercent, const juce::String& baselineCpu, const juce::String& currentCpu)
+    {
+        if (baselineCpu != currentCpu)
+            std::cout << "\nWarning: the baseline is from a different CPU (" << baselineCpu << "), the numbers won't line up\n";
+
+        auto comparisons = Benchmark::compare (baseline, current, thresholdPercent);
+
+        std::sort (comparisons.begin(), comparisons.end(), [] (const Benchmark::Comparison& a, const Benchmark::Comparison& b)
+        {
+            return a.changePercent > b.changePercent;
+        });
+
+        int nameWidth = 4;
+
+        for (const auto& comparison : comparisons)
+            nameWidth = juce::jmax (nameWidth, comparison.name.length());
+
+        std::cout << "\n" << juce::String ("Case").paddedRight (' ', nameWidth) << "  " << juce::String ("Before").paddedLeft (' ', 10)
+                  << "  " << juce::String ("After").paddedLeft (' ', 10) << "  " << juce::String ("Change").paddedLeft (' ', 9) << "\n";
+
+        int numRegressed = 0;
+        int numImproved = 0;
+
+        for (const auto& comparison : comparisons)
+        {
+            const juce::String change = (comparison.changePercent >= 0.0 ? "+" : "") + formatNumber (comparison.changePercent, 1) + "%";
+
+            std::cout << comparison.name.paddedRight (' ', nameWidth) << "  " << formatNumber (comparison.baseline).paddedLeft (' ', 10)
+                      << "  " << formatNumber (comparison.current).paddedLeft (' ', 10) << "  " << change.paddedLeft (' ', 9)
+                      << (comparison.regressed ? "  REGRESSED" : (comparison.improved ? "  faster" : "")) << "\n";
+
+            numRegressed += comparison.regressed ? 1 : 0;
+            numImproved += comparison.improved ? 1 : 0;
+        }
+
+        std::cout << "\n" << (int) comparisons.size() << " cases compared, " << numRegressed << " more than "
+                  << formatNumber (thresholdPercent, 1) << "% slower, " << numImproved << " faster\n";
+
+        return numRegressed == 0;
+    }
+    // The latency the host gets told has to be where an impulse actually comes out, otherwise the
+    // plugin sits a fraction of a sample off everything else and the dry/bypass paths don't line up.
+    // Measures the centre of mass of an impulse through each mode, which is the group delay at DC
+    // for any filter with unity gain there
+    bool checkOversamplerLatency()
+    {
+        using Oversampler = HalfBandOversampler<double>;
+        constexpr int length = 4096;    // long enough for the IIR tails to die away
+
+        bool allMatch = true;
+
+        std::cout << juce::String ("Mode").paddedRight (' ', 16) << "  " << juce::String ("Reported").paddedLeft (' ', 10)
+                  << "  " << juce::String ("Measured").paddedLeft (' ', 10) << "\n";
+
+        for (auto type : { Oversampler::FilterType::iir, Oversampler::FilterType::linearPhase })
+        {
+            for (int stages = 1; stages <= Oversampler::maxStages; ++stages)
+            {
+                Oversampler oversampler;
+                oversampler.prepare (1, length);
+                oversampler.setMode (stages, type);
+
+                std::vector<double> impulse ((size_t) length, 0.0);
+                impulse[0] = 1.0;
+
+                oversampler.processUp (0, impulse.data(), length);
+                oversampler.processDown (0, impulse.data(), length);
+
+                double sum = 0.0, weighted = 0.0;
+
+                for (int i = 0; i < length; ++i)
+                {
+                    sum += impulse[(size_t) i];
+                    weighted += (double) i * impulse[(size_t) i];
+                }
+
+                const double measured = weighted / sum;
+                const double reported = oversampler.getLatencyInSamples();
+                const bool matches = std::abs (measured - reported) < 0.01;
+                allMatch = allMatch && matches;
+
+                const juce::String mode = juce::String (1 << stages) + "x" + (type == Oversampler::FilterType::iir ? " iir" : " linear phase");
+
+                std::cout << mode.paddedRight (' ', 16) << "  " << formatNumber (reported, 4).paddedLeft (' ', 10)
+                          << "  " << formatNumber (measured, 4).paddedLeft (' ', 10) << (matches ? "" : "  MISMATCH") << "\n";
+            }
+        }
+
+        return allMatch;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (juce::String (juce::CharPointer_UTF8 (argv[i])));
+
+    Benchmark::Settings settings;
+    juce::StringArray filters;
+    juce::File outputFile, baselineFile;
+    double thresholdPercent = 10.0;
+    bool listOnly = false;
+    bool checkLatency = false;
+    juce::File compareBefore, compareAfter;
+
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const juce::String& arg = args[i];
+        const bool hasValue = i + 1 < args.size();
+
+        if (arg == "--help" || arg == "-h")
+        {
+            std::cout << usage;
+            return 0;
+        }
+        else if (arg == "--list")
+        {
+            listOnly = true;
+        }
+        else if (arg == "--quick")
+        {
+            settings.warmupSeconds = 0.01;
+            settings.repetitionSeconds = 0.01;
+            settings.repetitions = 3;
+        }
+        else if (arg == "--filter" && hasValue)
+        {
+            filters.add (args[++i]);
+        }
+        else if (arg == "--repetitions" && hasValue && args[i + 1].getIntValue() > 0)
+        {
+            settings.repetitions = args[++i].getIntValue();
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            outputFile = cwd.getChildFile (args[++i]);
+        }
+        else if (arg == "--baseline" && hasValue)
+        {
+            baselineFile = cwd.getChildFile (args[++i]);
+        }
+        else if (arg == "--threshold" && hasValue && args[i + 1].getDoubleValue() > 0.0)
+        {
+            thresholdPercent = args[++i].getDoubleValue();
+        }
+        else if (arg == "--check-latency")
+        {
+            checkLatency = true;
+        }
+        else if (arg == "--compare" && i + 2 < args.size())
+        {
+            compareBefore = cwd.getChildFile (args[++i]);
+            compareAfter = cwd.getChildFile (args[++i]);
+        }
+        else
+        {
+            std::cerr << "Don't know what to do with " << arg << "\n\n" << usage;
+            return 1;
+        }
+    }
+
+    // the options can come in any order, so the modes only get picked once they've all been read
+    if (checkLatency && compareBefore != juce::File())
+    {
+        std::cerr << "--check-latency and --compare are separate runs, give one of them\n\n" << usage;
+        return 1;
+    }
+
+    if (checkLatency)
+        return checkOversamplerLatency() ? 0 : 1;
+
+    if (compareBefore != juce::File())
+    {
+        // two saved runs, nothing gets timed
+        std::vector<Benchmark::Result> before, after;
+        juce::String beforeCpu, afterCpu;
+
+        if (! loadResults (compareBefore, before, beforeCpu) || ! loadResults (compareAfter, after, afterCpu))
+            return 1;
+
+        return printComparison (before, after, thresholdPercent, beforeCpu, afterCpu) ? 0 : 1;
+    }
+
+    // read it before spending minutes running, a typo shouldn't cost a whole run
+    std::vector<Benchmark::Result> baseline;
+    juce::String baselineCpu;
+
+    if (baselineFile != juce::File() && ! loadResults (baselineFile, baseline, baselineCpu))
+        return 1;
+
+    std::vector<Benchmark::Case> cases;
+
+    for (auto& benchmarkCase : makeCases())
+    {
+        bool wanted = filters.isEmpty();
+
+        for (const auto& filter : filters)
+            wanted = wanted || benchmarkCase.name.contains (filter);
+
+        if (wanted)
+            cases.push_back (std::move (benchmarkCase));
+    }
+
+    if (listOnly)
+    {
+        for (const auto& benchmarkCase : cases)
+            std::cout << benchmarkCase.name << "\n";
+
+        return 0;
+    }
+
+    if (cases.empty())
+    {
+        std::cerr << "No cases match\n";
+        return 1;
+    }
+
+    const auto machine = describeMachine();
+    std::cout << machine["cpu"].toString() << ", " << machine["kernels"].toString() << " kernels, "
+              << machine["build"].toString() << " build\n\n";
+
+    int nameWidth = 4;
+
+    for (const auto& benchmarkCase : cases)
+        nameWidth = juce::jmax (nameWidth, benchmarkCase.name.length());
+
+    std::cout << juce::String ("Case").paddedRight (' ', nameWidth) << "  " << juce::String ("Median").paddedLeft (' ', 10)
+              << "  " << juce::String ("Min").paddedLeft (' ', 10) << "  " << juce::String ("Unit").paddedRight (' ', 9)
+              << "  " << juce::String ("Realtime load").paddedLeft (' ', 13) << "\n";
+
+    std::vector<Benchmark::Result> results;
+
+    for (const auto& benchmarkCase : cases)
+    {
+        const auto result = Benchmark::run (benchmarkCase, settings);
+        results.push_back (result);
+
+        std::cout << result.name.paddedRight (' ', nameWidth) << "  " << formatNumber (result.median).paddedLeft (' ', 10)
+                  << "  " << formatNumber (result.min).paddedLeft (' ', 10) << "  " << result.unit.paddedRight (' ', 9)
+                  << "  " << (result.sampleRate > 0.0 ? formatNumber (result.getRealtimeLoad(), 3) + "%" : juce::String()).paddedLeft (' ', 13)
+                  << std::endl;
+    }
+
+    // A regression has to show up again before it counts, something else busy on the machine can
+    // slow one case down for a second. Whatever looks slower runs numRechecks more times and keeps
+    // its median run, not its best, so it only passes if most of its runs are in line with the baseline
+    if (baselineFile != juce::File())
+    {
+        for (const auto& comparison : Benchmark::compare (baseline, results, thresholdPercent))
+        {
+            if (! comparison.regressed)
+                continue;
+
+            const auto benchmarkCase = std::find_if (cases.begin(), cases.end(), [&comparison] (const Benchmark::Case& c)
+            {
+                return c.name == comparison.name;
+            });
+
+            auto previous = std::find_if (results.begin(), results.end(), [&comparison] (const Benchmark::Result& r)
+            {
+                return r.name == comparison.name;
+            });
+
+            std::vector<Benchmark::Result> runs { *previous };
+
+            for (int recheck = 0; recheck < numRechecks; ++recheck)
+            {
+                std::cout << "Running " << comparison.name << " again\n";
+                runs.push_back (Benchmark::run (*benchmarkCase, settings));
+            }
+
+            std::sort (runs.begin(), runs.end(), [] (const Benchmark::Result& x, const Benchmark::Result& y)
+            {
+                return x.median < y.median;
+            });
+
+            *previous = runs[runs.size() / 2];
+        }
+    }
+
+    if (outputFile != juce::File())
+    {
+        const auto json = Benchmark::toJson (results, machine, settings);
+
+        if (! outputFile.replaceWithText (juce::JSON::toString (json)))
+        {
+            std::cerr << "Couldn't write " << outputFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        std::cout << "\nResults written to " << outputFile.getFullPathName() << "\n";
+    }
+
+    if (baselineFile != juce::File())
+        return printComparison (baseline, results, thresholdPercent, baselineCpu, machine["cpu"].toString()) ? 0 : 1;
+
+    return 0;
+}
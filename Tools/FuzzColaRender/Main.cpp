@@ -0,0 +1,435 @@
+/*
+ ==============================================================================
+
+ Main.cpp
+ FuzzColaRender: runs audio files through the pedal without a host, lots of them at once.
+
+ ==============================================================================
+ */
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include "FuzzColaEngine.h"
+#include "FuzzColaPresets.h"
+#include "WorkStealingPool.h"
+
+namespace
+{
+    const char* const usage =
+        "Usage: FuzzColaRender [options] <file or folder>...\n"
+        "\n"
+        "Renders WAV and AIFF files through Fuzz Cola, the way a host bounce through the plugin would.\n"
+        "Folders get searched for .wav, .aif and .aiff files, all the way down.\n"
+        "\n"
+        "  --preset <p>     a factory preset by name or number, a preset .xml saved from the plugin\n"
+        "                   (or a session's state), or the name of one in the user preset folder\n"
+        "  --ir <file>      cabinet IR, turns the cabinet on (overrides the preset's)\n"
+        "  --output <dir>   where the results go, next to each input if not given\n"
+        "  --bits <n>       16, 24 or 32 (float, the default)\n"
+        "  --block <n>      samples read, processed and written at a time (default 65536)\n"
+        "  --threads <n>    files rendered at once (default: one per core)\n"
+        "  --list-presets   prints the factory and user presets\n";
+
+    // What every file gets rendered with
+    struct RenderSettings
+    {
+        FuzzColaPresetState state;
+        int bitDepth = 32;
+        int blockSize = 65536;
+        juce::File outputFolder;
+    };
+
+    struct RenderJob
+    {
+        juce::File input;
+        juce::File output;
+
+        // filled in by the render
+        bool succeeded = false;
+        juce::String error;
+        double audioSeconds = 0.0;
+        double wallSeconds = 0.0;
+    };
+
+    // The engine's own block size, the file I/O blocks get split into these. Small enough to stay
+    // in cache at 8x, big enough that the per block overhead is nothing
+    constexpr int processingBlockSize = 4096;
+
+    void listPresets()
+    {
+        std::cout << "Factory presets:\n";
+
+        const auto& factory = FuzzColaPresets::getFactoryPresets();
+
+        for (int i = 0; i < factory.size(); ++i)
+            std::cout << "  " << (i + 1) << "  " << factory.getReference (i).name << "\n";
+
+        const auto folder = FuzzColaPresets::getUserPresetFolder();
+        std::cout << "User presets (" << folder.getFullPathName() << "):\n";
+
+        for (const auto& file : folder.findChildFiles (juce::File::findFiles, false, "*.xml"))
+            std::cout << "     " << file.getFileNameWithoutExtension() << "\n";
+    }
+
+    // factory by name or number first, then a file, then the user preset folder
+    bool findPreset (const juce::String& preset, FuzzColaPresetState& state)
+    {
+        const auto& factory = FuzzColaPresets::getFactoryPresets();
+
+        for (int i = 0; i < factory.size(); ++i)
+        {
+            const auto& candidate = factory.getReference (i);
+
+            if (candidate.name.equalsIgnoreCase (preset) || preset == juce::String (i + 1))
+            {
+                candidate.applyTo (state.parameters);
+                return true;
+            }
+        }
+
+        const auto file = juce::File::getCurrentWorkingDirectory().getChildFile (preset);
+
+        if (file.existsAsFile())
+            return FuzzColaPresets::readStateFromFile (file, state);
+
+        return FuzzColaPresets::readStateFromFile (FuzzColaPresets::getUserPresetFolder()
+                                                       .getChildFile (preset).withFileExtension (".xml"), state);
+    }
+
+    const juce::String resultSuffix = " (Fuzz Cola)";
+
+    void addInputs (const juce::File& file, juce::Array<juce::File>& inputs)
+    {
+        const juce::String wildcard = "*.wav;*.aif;*.aiff";
+
+        if (file.isDirectory())
+        {
+            auto found = file.findChildFiles (juce::File::findFiles, true, wildcard);
+            found.sort();
+
+            // not what an earlier run left next to its inputs
+            for (const auto& candidate : found)
+                if (! candidate.getFileNameWithoutExtension().endsWith (resultSuffix))
+                    inputs.add (candidate);
+        }
+        else
+        {
+            inputs.add (file);
+        }
+    }
+
+    // Streams the file through in settings.blockSize pieces, the first latency samples of the
+    // output get dropped and the tail gets rendered from silence after the end, so the result
+    // lines up with the input and rings out the way it would in a host
+    void render (RenderJob& job, const RenderSettings& settings)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (job.input));
+
+        if (reader == nullptr)
+        {
+            job.error = "couldn't read it";
+            return;
+        }
+
+        const int numChannels = (int) reader->numChannels;
+        const double sampleRate = reader->sampleRate;
+
+        if (numChannels < 1 || numChannels > FuzzColaEngine::maxChannels)
+        {
+            job.error = juce::String (numChannels) + " channels, only mono and stereo work";
+            return;
+        }
+
+        // offline, as in a host bounce: the render profile as the preset has it
+        FuzzColaEngineOptions options = settings.state.options;
+        options.offline = true;
+
+        FuzzColaEngine engine;
+        engine.setOptions (options);
+        engine.setParameters (settings.state.parameters);
+        engine.prepare (sampleRate, processingBlockSize);
+
+        if (settings.state.cabinetEnabled && ! engine.loadImpulseResponse (settings.state.impulseResponse))
+        {
+            job.error = "couldn't read the IR " + settings.state.impulseResponse.getFullPathName();
+            return;
+        }
+
+        engine.reset();
+
+        const juce::int64 inputLength = reader->lengthInSamples;
+        const int latency = engine.getLatencyInSamples();
+        const auto tailLength = (juce::int64) std::ceil (engine.getTailLengthSeconds() * sampleRate);
+        const juce::int64 renderLength = inputLength + tailLength;
+
+        // written next to the result and moved over it once it's all there, so a failed render
+        // never leaves half a file behind (or wipes an older good one)
+        job.output.getParentDirectory().createDirectory();
+        juce::TemporaryFile temporary (job.output);
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+
+        auto stream = std::make_unique<juce::FileOutputStream> (temporary.getFile());
+
+        if (stream->openedOk())
+            writer.reset (wav.createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels,
+                                               settings.bitDepth, {}, 0));
+
+        if (writer != nullptr)
+            stream.release();    // the writer owns it now
+
+        if (writer == nullptr)
+        {
+            job.error = "couldn't write " + job.output.getFullPathName();
+            return;
+        }
+
+        juce::AudioBuffer<float> buffer (numChannels, settings.blockSize);
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+
+        for (juce::int64 position = 0; position < renderLength;)
+        {
+            const int numSamples = (int) juce::jmin ((juce::int64) settings.blockSize, renderLength - position);
+
+            // past the end the reader fills in silence, which is the tail
+            reader->read (&buffer, 0, numSamples, position, true, numChannels > 1);
+            engine.process (buffer.getArrayOfWritePointers(), numChannels, numChannels, numSamples);
+
+            // the first latency samples are from before the file started
+            const int skip = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numSamples, latency - position);
+
+            if (skip < numSamples && ! writer->writeFromAudioSampleBuffer (buffer, skip, numSamples - skip))
+            {
+                job.error = "couldn't write " + job.output.getFullPathName();
+                return;
+            }
+
+            position += numSamples;
+        }
+
+        job.wallSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+        job.audioSeconds = (double) inputLength / sampleRate;
+
+        writer.reset();
+
+        if (! temporary.overwriteTargetFileWithTemporary())
+        {
+            job.error = "couldn't write " + job.output.getFullPathName();
+            return;
+        }
+
+        job.succeeded = true;
+    }
+
+    juce::String formatSeconds (double seconds)
+    {
+        return juce::String (seconds, 2) + " s";
+    }
+
+    juce::String formatFactor (double audioSeconds, double wallSeconds)
+    {
+        return wallSeconds > 0.0 ? juce::String (audioSeconds / wallSeconds, 1) + "x" : juce::String ("-");
+    }
+
+    // Per file and overall: how much audio, how long it took, and how many times faster than
+    // realtime that is. The overall factor is for the whole batch against the wall clock, so it
+    // includes what running files side by side bought
+    void printReport (const std::vector<RenderJob>& jobs, double totalWallSeconds, int numThreads)
+    {
+        int nameWidth = 4;
+
+        for (const auto& job : jobs)
+            nameWidth = juce::jmax (nameWidth, job.input.getFileName().length());
+
+        auto row = [nameWidth] (const juce::String& name, const juce::String& audio,
+                                const juce::String& wall, const juce::String& factor)
+        {
+            std::cout << name.paddedRight (' ', nameWidth) << "  " << audio.paddedLeft (' ', 10)
+                      << "  " << wall.paddedLeft (' ', 10) << "  " << factor.paddedLeft (' ', 10) << "\n";
+        };
+
+        std::cout << "\n";
+        row ("File", "Audio", "Time", "Realtime");
+
+        double totalAudioSeconds = 0.0;
+        double totalRenderSeconds = 0.0;
+        int numFailed = 0;
+
+        for (const auto& job : jobs)
+        {
+            if (! job.succeeded)
+            {
+                std::cout << job.input.getFileName().paddedRight (' ', nameWidth) << "  failed: " << job.error << "\n";
+                ++numFailed;
+                continue;
+            }
+
+            row (job.input.getFileName(), formatSeconds (job.audioSeconds), formatSeconds (job.wallSeconds),
+                 formatFactor (job.audioSeconds, job.wallSeconds));
+
+            totalAudioSeconds += job.audioSeconds;
+            totalRenderSeconds += job.wallSeconds;
+        }
+
+        std::cout << "\n";
+        row ("Total", formatSeconds (totalAudioSeconds), formatSeconds (totalWallSeconds),
+             formatFactor (totalAudioSeconds, totalWallSeconds));
+
+        std::cout << "\n" << (int) jobs.size() - numFailed << " of " << (int) jobs.size() << " rendered on "
+                  << numThreads << (numThreads == 1 ? " thread" : " threads")
+                  << ", each file averaging " << formatFactor (totalAudioSeconds, totalRenderSeconds) << " realtime\n";
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (juce::String (juce::CharPointer_UTF8 (argv[i])));
+
+    RenderSettings settings;
+    int numThreads = juce::SystemStats::getNumCpus();
+    juce::String presetName;
+    juce::File irFile;
+    juce::Array<juce::File> inputs;
+
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const juce::String& arg = args[i];
+
+        // everything except --list-presets and --help takes a value
+        auto value = [&] (juce::String& result)
+        {
+            if (i + 1 >= args.size())
+                return false;
+
+            result = args[++i];
+            return true;
+        };
+
+        juce::String text;
+
+        if (arg == "--help" || arg == "-h")
+        {
+            std::cout << usage;
+            return 0;
+        }
+        else if (arg == "--list-presets")
+        {
+            listPresets();
+            return 0;
+        }
+        else if (arg == "--preset" && value (text))
+        {
+            presetName = text;
+        }
+        else if (arg == "--ir" && value (text))
+        {
+            irFile = cwd.getChildFile (text);
+        }
+        else if (arg == "--output" && value (text))
+        {
+            settings.outputFolder = cwd.getChildFile (text);
+        }
+        else if (arg == "--bits" && value (text) && (text == "16" || text == "24" || text == "32"))
+        {
+            settings.bitDepth = text.getIntValue();
+        }
+        else if (arg == "--block" && value (text) && text.getIntValue() > 0)
+        {
+            settings.blockSize = text.getIntValue();
+        }
+        else if (arg == "--threads" && value (text) && text.getIntValue() > 0)
+        {
+            numThreads = text.getIntValue();
+        }
+        else if (arg.startsWith ("-"))
+        {
+            std::cerr << "Don't know what to do with " << (arg + " " + text).trim() << "\n\n" << usage;
+            return 1;
+        }
+        else
+        {
+            addInputs (cwd.getChildFile (arg), inputs);
+        }
+    }
+
+    if (inputs.isEmpty())
+    {
+        std::cerr << usage;
+        return 1;
+    }
+
+    if (presetName.isNotEmpty() && ! findPreset (presetName, settings.state))
+    {
+        std::cerr << "No preset called " << presetName << ", --list-presets shows them\n";
+        return 1;
+    }
+
+    if (irFile != juce::File())
+    {
+        settings.state.cabinetEnabled = true;
+        settings.state.impulseResponse = irFile;
+    }
+
+    // the plugin goes on without the cabinet when the IR has gone, here that's worth a warning
+    if (settings.state.cabinetEnabled && ! settings.state.impulseResponse.existsAsFile())
+    {
+        std::cerr << "Warning: the cabinet's on but there's no IR at \""
+                  << settings.state.impulseResponse.getFullPathName() << "\", rendering without it\n";
+        settings.state.cabinetEnabled = false;
+    }
+
+    std::vector<RenderJob> jobs ((size_t) inputs.size());
+    WorkStealingPool pool (numThreads);
+    std::mutex outputLock;
+    std::set<juce::String> outputs;
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        RenderJob& job = jobs[i];
+        job.input = inputs.getReference ((int) i);
+
+        // two inputs with the same name from different folders don't get to share an output
+        const juce::File folder = settings.outputFolder != juce::File() ? settings.outputFolder
+                                                                        : job.input.getParentDirectory();
+        const juce::String name = job.input.getFileNameWithoutExtension() + resultSuffix;
+        job.output = folder.getChildFile (name + ".wav");
+
+        for (int copy = 2; ! outputs.insert (job.output.getFullPathName()).second; ++copy)
+            job.output = folder.getChildFile (name + " " + juce::String (copy) + ".wav");
+
+        // longest first, the file size is close enough
+        pool.add ([&job, &settings, &outputLock]
+                  {
+                      render (job, settings);
+
+                      const std::lock_guard<std::mutex> guard (outputLock);
+                      std::cout << (job.succeeded ? "Rendered " : "Failed   ") << job.input.getFileName() << "\n";
+                  },
+                  (double) job.input.getSize());
+    }
+
+    std::cout << "Rendering " << (int) jobs.size() << (jobs.size() == 1 ? " file" : " files") << "\n";
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    pool.run();
+    const double totalWallSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+    printReport (jobs, totalWallSeconds, juce::jmin (numThreads, (int) jobs.size()));
+
+    for (const auto& job : jobs)
+        if (! job.succeeded)
+            return 1;
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ ==============================================================================
+
+ WorkStealingPool.h
+ A fixed set of threads chewing through a known list of jobs.
+
+ ==============================================================================
+ */
+
+#pragma once
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Every thread has its own queue and takes from the front of it, once that's empty it steals from
+// the back of whichever other queue has the most left. The jobs get dealt out biggest first, so
+// the long files start early and the short ones fill in the gaps at the end, and nobody sits idle
+// while one thread is still stuck with a queue of big ones.
+// Jobs are whole files here (hundreds of ms each), so a mutex per queue costs nothing worth
+// a lock free deque
+class WorkStealingPool
+{
+    public:
+    using Job = std::function<void()>;
+
+    explicit WorkStealingPool (int numThreadsToUse)
+        : queues ((size_t) std::max (1, numThreadsToUse))
+    {
+    }
+
+    // cost is only used for the order, anything that grows with the job's size will do
+    void add (Job job, double cost)
+    {
+        pending.push_back ({ std::move (job), cost });
+    }
+
+    // runs everything added so far and returns once it's all done
+    void run()
+    {
+        std::stable_sort (pending.begin(), pending.end(),
+                          [] (const Pending& a, const Pending& b) { return a.cost > b.cost; });
+
+        const size_t numThreads = std::min (queues.size(), std::max<size_t> (1, pending.size()));
+
+        for (size_t i = 0; i < pending.size(); ++i)
+            queues[i % numThreads].jobs.push_back (std::move (pending[i].job));
+
+        pending.clear();
+
+        std::vector<std::thread> threads;
+
+        for (size_t i = 1; i < numThreads; ++i)
+            threads.emplace_back ([this, i] { work (i); });
+
+        work (0);    // this thread is one of them
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    private:
+    struct Pending
+    {
+        Job job;
+        double cost;
+    };
+
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<Pending> pending;
+    std::vector<Queue> queues;
+
+    // Nothing gets added while it runs, so once every queue is empty it's finished
+    void work (size_t index)
+    {
+        for (;;)
+        {
+            Job job;
+
+            if (! popOwn (index, job) && ! steal (index, job))
+                return;
+
+            job();
+        }
+    }
+
+    bool popOwn (size_t index, Job& job)
+    {
+        Queue& queue = queues[index];
+        std::lock_guard<std::mutex> guard (queue.lock);
+
+        if (queue.jobs.empty())
+            return false;
+
+        job = std::move (queue.jobs.front());
+        queue.jobs.pop_front();
+        return true;
+    }
+
+    bool steal (size_t thief, Job& job)
+    {
+        for (;;)
+        {
+            // the sizes are only a hint, somebody can get there first so check again under the lock
+            size_t victim = thief;
+            size_t mostLeft = 0;
+
+            for (size_t i = 0; i < queues.size(); ++i)
+            {
+                if (i == thief)
+                    continue;
+
+                std::lock_guard<std::mutex> guard (queues[i].lock);
+
+                if (queues[i].jobs.size() > mostLeft)
+                {
+                    mostLeft = queues[i].jobs.size();
+                    victim = i;
+                }
+            }
+
+            if (victim == thief)
+                return false;
+
+            Queue& queue = queues[victim];
+            std::lock_guard<std::mutex> guard (queue.lock);
+
+            if (! queue.jobs.empty())
+            {
+                job = std::move (queue.jobs.back());
+                queue.jobs.pop_back();
+                return true;
+            }
+        }
+    }
+
+    WorkStealingPool (const WorkStealingPool&) = delete;
+    WorkStealingPool& operator= (const WorkStealingPool&) = delete;
+};